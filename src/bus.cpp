@@ -15,23 +15,76 @@ MemoryBus::MemoryBus(NES::PPU &_ppu, NES::APU &_apu,
       controller1(_ctrl1), controller2(_ctrl2) {
     // Ram state is not consistent on a real machine
     std::fill(ram.begin(), ram.end(), 0x0);
+
+    // 0x0000 - 0x00FF is zero page
+    // 0x0100 - 0x01FF is stack memory
+    // 0x0200 - 0x07FF is RAM, mirrored up to 0x1FFF
+    for (int page = 0; page < 0x2000 / page_sz; page++) {
+        uint8_t *host = &ram[(page * page_sz) % ram_size];
+        read_pages[page] = host;
+        write_pages[page] = host;
+    }
 }
 
-uint8_t MemoryBus::read(uint16_t addr, bool passive) {
-    switch (addr) {
-    // Internal RAM
-    case 0x0000 ... 0x1FFF:
-        // 0x0000 - 0x00FF is zero page
-        // 0x0100 - 0x01FF is stack memory
-        // 0x0200 - 0x07FF is RAM
-        NES_LOG("Bus") << "Read internal RAM @ 0x" << std::hex << std::setw(4)
-                       << std::setfill('0') << addr % 0x800 << ", value: 0x"
-                       << std::setw(2) << std::setfill('0')
-                       << (uint16_t)ram[addr % 0x800] << std::endl;
-        return ram[addr % 0x800];
+void MemoryBus::set_mapper(iNESv1::Mapper::Base *_mapper) {
+    mapper = _mapper;
+    if (mapper)
+        mapper->on_prg_bank_switch.push_back([this]() { map_prg_pages(); });
+    map_prg_pages();
+}
+
+void MemoryBus::map_prg_pages() {
+    for (int page = 0x4000 / page_sz; page < page_count; page++) {
+        read_pages[page] = nullptr;
+        write_pages[page] = nullptr;
+        if (!mapper) continue;
+
+        uint16_t addr = page * page_sz;
+        auto &cart = mapper->cartridge;
+        // Pages which aren't fully backed by host memory go through the
+        // mapper
+        int32_t ram_off = mapper->prg_ram_offset(addr);
+        if (ram_off >= 0 && (size_t)ram_off + page_sz <= cart.prg_ram.size()) {
+            read_pages[page] = &cart.prg_ram[ram_off];
+            write_pages[page] = &cart.prg_ram[ram_off];
+            continue;
+        }
+        int32_t rom_off = mapper->prg_rom_offset(addr);
+        if (rom_off >= 0 && (size_t)rom_off + page_sz <= cart.prg_rom.size())
+            read_pages[page] = &cart.prg_rom[rom_off];
+    }
+}
+
+bool MemoryBus::dma_oam(uint8_t page) {
+    static_assert(page_sz == 0x100, "DMA pages have to map to bus pages");
+    const uint8_t *data = read_pages[page];
+    if (!data) return false;
+    ppu.dma_oam(data);
+    return true;
+}
 
+uint8_t MemoryBus::stable_bits(uint16_t addr) const {
+    // Memory only changes through CPU writes
+    if (read_pages[addr >> page_bits]) return 0xFF;
+    // Once read, the vblank flag stays clear until the next vblank. Sprite
+    // 0 hit and overflow can change during rendering.
+    if (addr >= 0x2000 && addr < 0x4000 && (addr & 0x7) == 0x2 &&
+        !ppu.ppustatus.vblank)
+        return 0x80;
+    return 0x0;
+}
+
+void MemoryBus::catch_up_ppu() {
+    if (sync_ppu) ppu.sync(cpu->op_timestamp());
+}
+
+uint8_t MemoryBus::read_io(uint16_t addr, bool passive) {
+    switch (addr) {
     // PPU registers
-    case 0x2000 ... 0x3FFF: return ppu.cpu_read(0x2000 + ((addr - 0x2000) % 8), passive);
+    case 0x2000 ... 0x3FFF:
+        // Passive reads come from debugging tools between instructions
+        if (!passive) catch_up_ppu();
+        return ppu.cpu_read(0x2000 + ((addr - 0x2000) % 8), passive);
 
     // APU registers
     case 0x4000 ... 0x4015:
@@ -65,31 +118,29 @@ uint8_t MemoryBus::read(uint16_t addr, bool passive) {
     }
 }
 
-void MemoryBus::write(uint16_t addr, uint8_t val) {
+void MemoryBus::write_io(uint16_t addr, uint8_t val) {
     switch (addr) {
-    case 0x0000 ... 0x1FFF:
-        NES_LOG("Bus") << "Write to internal RAM @ 0x" << std::hex
-                       << std::setw(4) << std::setfill('0') << addr % 0x800
-                       << " value: 0x" << std::setw(2) << std::setfill('0')
-                       << (uint16_t)val << std::endl;
-        ram[addr % 0x800] = val;
-        break;
     case 0x2000 ... 0x3FFF:
+        catch_up_ppu();
         ppu.cpu_write(0x2000 + ((addr - 0x2000) % 8), val);
         break;
     case 0x4000 ... 0x4017:
-        if (addr == 0x4014)
+        if (addr == 0x4014) {
+            // The DMA writes OAM right after this instruction
+            catch_up_ppu();
             return cpu->schedule_dma_oam(val);
-        else if (addr == 0x4016) {
+        } else if (addr == 0x4016) {
             controller1.write(val);
             controller2.write(val);
             return;
         } else
             return apu.write(addr, val);
     case 0x4020 ... 0xFFFF:
-        if (mapper)
+        // Bank switches and mirroring changes affect the PPU
+        if (mapper) {
+            catch_up_ppu();
             mapper->write_prg(addr, val);
-        else
+        } else
             throw MissingCartridge();
         break;
     default:
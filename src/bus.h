@@ -3,12 +3,14 @@
 
 #include <apu.h>
 #include <controller.h>
+#include <log.h>
 #include <mapper.h>
 #include <ppu.h>
 
 #include <array>
 #include <cstdint>
 #include <functional>
+#include <iomanip>
 #include <optional>
 
 namespace NES {
@@ -31,9 +33,14 @@ class MemoryBusIntf {
     /// \param addr Address to write the value to.
     /// \param val Value to write.
     virtual void write(uint16_t addr, uint8_t val) = 0;
+
+    /// Attaches a cartridge mapper to the bus.
+    virtual void set_mapper(iNESv1::Mapper::Base *_mapper) {
+        mapper = _mapper;
+    }
 };
 
-class MemoryBus : public MemoryBusIntf {
+class MemoryBus final : public MemoryBusIntf {
    public:
     static const int ram_size = 0x800;  ///< NES Internal RAM size.
 
@@ -43,6 +50,21 @@ class MemoryBus : public MemoryBusIntf {
     NES::Controller &controller1;
     NES::Controller &controller2;
     std::array<uint8_t, ram_size> ram;  ///< Internal RAM
+    /// Catch the PPU up before accesses that observe or change its state,
+    /// so it only has to be synchronized at the end of `CPU::run` otherwise.
+    /// Off if the PPU isn't emulated.
+    bool sync_ppu = true;
+
+    static const int page_bits = 8;              ///< Page size as a shift.
+    static const int page_sz = 1 << page_bits;   ///< Page size - 256B.
+    static const int page_count = 0x10000 >> page_bits;
+
+    /// Host memory backing each CPU page, or nullptr if accesses to the page
+    /// have side effects and go through `read_io`/`write_io`. Internal RAM
+    /// mirrors, PRG RAM and the current PRG ROM banks are mapped for reads,
+    /// only RAM is mapped for writes.
+    std::array<const uint8_t *, page_count> read_pages{};
+    std::array<uint8_t *, page_count> write_pages{};
 
     /// Initializes the memory bus.
     MemoryBus(NES::PPU &_ppu, NES::APU &_apu,
@@ -52,12 +74,62 @@ class MemoryBus : public MemoryBusIntf {
     /// \param addr Address to read from.
     /// \param passive Don't trigger additional read behaviour
     /// \return Byte that has been read.
-    uint8_t read(uint16_t addr, bool passive=false) final;
+    uint8_t read(uint16_t addr, bool passive=false) final {
+        // RAM and ROM pages are read directly, the rest goes through read_io
+        if (const uint8_t *page = read_pages[addr >> page_bits]) {
+            NES_LOG("Bus") << "Read mapped page @ 0x" << std::hex
+                           << std::setw(4) << std::setfill('0') << addr
+                           << ", value: 0x" << std::setw(2)
+                           << std::setfill('0')
+                           << (uint16_t)page[addr & (page_sz - 1)]
+                           << std::endl;
+            return page[addr & (page_sz - 1)];
+        }
+        return read_io(addr, passive);
+    }
 
     /// Writes a value to the provided address.
     /// \param addr Address to write the value to.
     /// \param val Value to write.
-    void write(uint16_t addr, uint8_t val) final;
+    void write(uint16_t addr, uint8_t val) final {
+        if (uint8_t *page = write_pages[addr >> page_bits]) {
+            NES_LOG("Bus") << "Write to mapped page @ 0x" << std::hex
+                           << std::setw(4) << std::setfill('0') << addr
+                           << " value: 0x" << std::setw(2) << std::setfill('0')
+                           << (uint16_t)val << std::endl;
+            page[addr & (page_sz - 1)] = val;
+            return;
+        }
+        write_io(addr, val);
+    }
+
+    /// Attaches a cartridge mapper and maps its PRG memory.
+    void set_mapper(iNESv1::Mapper::Base *mapper) final;
+
+    /// Copies a page to PPU OAM in one go if it's plain memory, the same as
+    /// OAM DMA reading it and writing every byte to OAMDATA.
+    /// \param page Page to copy
+    /// \return `false` if the page has to be read through the bus.
+    bool dma_oam(uint8_t page);
+
+    /// Returns the bits of the value at addr which read the same and can be
+    /// read again without side effects until the CPU writes to the bus or
+    /// the PPU sets vblank. Used by the CPU to skip polling loops.
+    uint8_t stable_bits(uint16_t addr) const;
+
+   private:
+    /// Runs the PPU up to the start of the current instruction, which is
+    /// where it would be if the CPU stopped before every PPU access.
+    void catch_up_ppu();
+
+    /// Reads registers and cartridge space, see `read`.
+    uint8_t read_io(uint16_t addr, bool passive);
+
+    /// Writes registers and cartridge space, see `write`.
+    void write_io(uint16_t addr, uint8_t val);
+
+    /// Rebuilds the cartridge space pages from the current mapper banks.
+    void map_prg_pages();
 };
 
 class MissingCartridge {};
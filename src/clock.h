@@ -0,0 +1,19 @@
+#ifndef INC_2A03_CLOCK_H
+#define INC_2A03_CLOCK_H
+
+#include <cstdint>
+
+namespace NES {
+
+/// Master clock timestamp in NTSC master crystal ticks (21.477272 MHz).
+/// Every component keeps the timestamp it has been run up to, so progress
+/// of the CPU, PPU and APU can be compared without conversions. 64 bits
+/// last for over 27000 years of emulated time.
+using Timestamp = uint64_t;
+
+const Timestamp cpu_cycle_ticks = 12;  ///< Master clock ticks per CPU cycle.
+const Timestamp ppu_dot_ticks = 4;     ///< Master clock ticks per PPU dot.
+
+}  // namespace NES
+
+#endif  // INC_2A03_CLOCK_H
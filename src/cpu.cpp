@@ -1,12 +1,13 @@
 #include <bus.h>
 #include <cpu.h>
 #include <log.h>
+#include <opcodes.h>
+#include <test/bus.h>
 
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
-#include <limits>
 
 using namespace std;
 
@@ -81,24 +82,29 @@ using namespace std;
 
 using namespace NES;
 
-CPU::CPU(NES::MemoryBusIntf *bus) : bus(bus) {
+CPU::CPU() {
     A = 0x0;
     X = 0x0;
     Y = 0x0;
     S = 0xFD;
-    P.status = 0x24;
+    set_status(0x24);
     cycles = 0;
-    IRQ = NMI = false;
 }
 
-void CPU::power() {
+template <class Bus>
+CPUCore<Bus>::CPUCore(Bus *bus) : bus(bus) {}
+
+template <class Bus>
+void CPUCore<Bus>::power() {
     A = 0x0;
     X = 0x0;
     Y = 0x0;
     S = 0xFD;
-    P.status = 0x24;
+    set_status(0x24);
     cycles = 0;
-    IRQ = NMI = false;
+    scheduler.clear();
+    dma = DMA_Clear;
+    NES_PROFILE(profiler.clear());
 
     for (uint16_t i = 0x4000; i <= 0x4013; i++) write(i, 0x0);
     write(0x4015, 0x0);  // All channels disabled
@@ -111,313 +117,540 @@ void CPU::power() {
     reset();
 }
 
-void CPU::reset() { interrupt(i_reset); }
-
-uint16_t CPU::execute() {
-    uint32_t initial_cyc = cycles;
-    opcode = read(PC++);
-    switch (opcode) {
-    case 0x0: BRK(); break;
-    case 0x10: BPL(); break;
-    case 0x30: BMI(); break;
-    case 0x50: BVC(); break;
-    case 0x70: BVS(); break;
-    case 0x90: BCC(); break;
-    case 0xB0: BCS(); break;
-    case 0xD0: BNE(); break;
-    case 0xF0: BEQ(); break;
-    case 0x4C: JMP(abs); break;
-    case 0x6C: JMP(ind); break;
-    case 0x20: JSR(); break;
-    case 0x60: RTS(); break;
-    case 0x40: RTI(); break;
-    case 0x69: ADC(imm); break;
-    case 0x65: ADC(zp); break;
-    case 0x75: ADC(zp_x); break;
-    case 0x6D: ADC(abs); break;
-    case 0x7D: ADC(abs_x); break;
-    case 0x79: ADC(abs_y); break;
-    case 0x61: ADC(idx_ind_x); break;
-    case 0x71: ADC(ind_idx_y); break;
-    case 0x29: AND(imm); break;
-    case 0x25: AND(zp); break;
-    case 0x35: AND(zp_x); break;
-    case 0x2D: AND(abs); break;
-    case 0x3D: AND(abs_x); break;
-    case 0x39: AND(abs_y); break;
-    case 0x21: AND(idx_ind_x); break;
-    case 0x31: AND(ind_idx_y); break;
-    case 0x0A: ASL_A(); break;
-    case 0x06: ASL(zp); break;
-    case 0x16: ASL(zp_x); break;
-    case 0x0E: ASL(abs); break;
-    case 0x1E: ASL(abs_x); break;
-    case 0x24: BIT(zp); break;
-    case 0x2C: BIT(abs); break;
-    case 0xC9: CMP(imm); break;
-    case 0xC5: CMP(zp); break;
-    case 0xD5: CMP(zp_x); break;
-    case 0xCD: CMP(abs); break;
-    case 0xDD: CMP(abs_x); break;
-    case 0xD9: CMP(abs_y); break;
-    case 0xC1: CMP(idx_ind_x); break;
-    case 0xD1: CMP(ind_idx_y); break;
-    case 0xE0: CP(X, imm); break;
-    case 0xE4: CP(X, zp); break;
-    case 0xEC: CP(X, abs); break;
-    case 0xC0: CP(Y, imm); break;
-    case 0xC4: CP(Y, zp); break;
-    case 0xCC: CP(Y, abs); break;
-    case 0xC6: DEC(zp); break;
-    case 0xD6: DEC(zp_x); break;
-    case 0xCE: DEC(abs); break;
-    case 0xDE: DEC(abs_x); break;
-    case 0x49: EOR(imm); break;
-    case 0x45: EOR(zp); break;
-    case 0x55: EOR(zp_x); break;
-    case 0x4D: EOR(abs); break;
-    case 0x5D: EOR(abs_x); break;
-    case 0x59: EOR(abs_y); break;
-    case 0x41: EOR(idx_ind_x); break;
-    case 0x51: EOR(ind_idx_y); break;
-    case 0x18: CLC(); break;
-    case 0x38: SEC(); break;
-    case 0x58: CLI(); break;
-    case 0x78: SEI(); break;
-    case 0xB8: CLV(); break;
-    case 0xD8: CLD(); break;
-    case 0xF8: SED(); break;
-    case 0x4A: LSR_A(); break;
-    case 0x46: LSR(zp); break;
-    case 0x56: LSR(zp_x); break;
-    case 0x4E: LSR(abs); break;
-    case 0x5E: LSR(abs_x); break;
-    case 0x09: ORA(imm); break;
-    case 0x05: ORA(zp); break;
-    case 0x15: ORA(zp_x); break;
-    case 0x0D: ORA(abs); break;
-    case 0x1D: ORA(abs_x); break;
-    case 0x19: ORA(abs_y); break;
-    case 0x01: ORA(idx_ind_x); break;
-    case 0x11: ORA(ind_idx_y); break;
-    case 0x2A: ROL_A(); break;
-    case 0x26: ROL(zp); break;
-    case 0x36: ROL(zp_x); break;
-    case 0x2E: ROL(abs); break;
-    case 0x3E: ROL(abs_x); break;
-    case 0x6A: ROR_A(); break;
-    case 0x66: ROR(zp); break;
-    case 0x76: ROR(zp_x); break;
-    case 0x6E: ROR(abs); break;
-    case 0x7E: ROR(abs_x); break;
-    case 0xE9: SBC(imm); break;
-    case 0xE5: SBC(zp); break;
-    case 0xF5: SBC(zp_x); break;
-    case 0xED: SBC(abs); break;
-    case 0xFD: SBC(abs_x); break;
-    case 0xF9: SBC(abs_y); break;
-    case 0xE1: SBC(idx_ind_x); break;
-    case 0xF1: SBC(ind_idx_y); break;
-    case 0xA9: LD(A, imm); break;
-    case 0xA5: LD(A, zp); break;
-    case 0xB5: LD(A, zp_x); break;
-    case 0xAD: LD(A, abs); break;
-    case 0xBD: LD(A, abs_x); break;
-    case 0xB9: LD(A, abs_y); break;
-    case 0xA1: LD(A, idx_ind_x); break;
-    case 0xB1: LD(A, ind_idx_y); break;
-    case 0xA2: LD(X, imm); break;
-    case 0xA6: LD(X, zp); break;
-    case 0xB6: LD(X, zp_y); break;
-    case 0xAE: LD(X, abs); break;
-    case 0xBE: LD(X, abs_y); break;
-    case 0xA0: LD(Y, imm); break;
-    case 0xA4: LD(Y, zp); break;
-    case 0xB4: LD(Y, zp_x); break;
-    case 0xAC: LD(Y, abs); break;
-    case 0xBC: LD(Y, abs_x); break;
-    case 0x85: ST(A, zp); break;
-    case 0x95: ST(A, zp_x); break;
-    case 0x8D: ST(A, abs); break;
-    case 0x9D: ST(A, abs_x); break;
-    case 0x99: ST(A, abs_y); break;
-    case 0x81: ST(A, idx_ind_x); break;
-    case 0x91: ST(A, ind_idx_y); break;
-    case 0x86: ST(X, zp); break;
-    case 0x96: ST(X, zp_y); break;
-    case 0x8E: ST(X, abs); break;
-    case 0x84: ST(Y, zp); break;
-    case 0x94: ST(Y, zp_x); break;
-    case 0x8C: ST(Y, abs); break;
-    case 0xE6: INC(zp); break;
-    case 0xF6: INC(zp_x); break;
-    case 0xEE: INC(abs); break;
-    case 0xFE: INC(abs_x); break;
-    case 0xAA: T(A, X); break;
-    case 0x8A: T(X, A); break;
-    case 0xA8: T(A, Y); break;
-    case 0x98: T(Y, A); break;
-    case 0xCA: DE(X); break;
-    case 0xE8: IN(X); break;
-    case 0x88: DE(Y); break;
-    case 0xC8: IN(Y); break;
-    case 0x9A: T(X, S); break;
-    case 0xBA: T(S, X); break;
-    case 0x48: PH(A); break;
-    case 0x08: PH(P); break;
-    case 0x68: PL(A); break;
-    case 0x28: PL(P); break;
-    case 0xEA: /* NOP */ cycles += 2; break;
-    // Unofficial
-    case 0xA7: LAX(zp); break;
-    case 0xB7: LAX(zp_y); break;
-    case 0xAF: LAX(abs); break;
-    case 0xBF: LAX(abs_y); break;
-    case 0xA3: LAX(idx_ind_x); break;
-    case 0xB3: LAX(ind_idx_y); break;
-    case 0xAB: LXA(); break;
-    case 0x87: SAX(zp); break;
-    case 0x97: SAX(zp_y); break;
-    case 0x8F: SAX(abs); break;
-    case 0x83: SAX(idx_ind_x); break;
-    case 0xCB: SBX(); break;
-    case 0xEB: USBC(); break;
-    case 0xC7: DCP(zp); break;
-    case 0xD7: DCP(zp_x); break;
-    case 0xCF: DCP(abs); break;
-    case 0xDF: DCP(abs_x); break;
-    case 0xDB: DCP(abs_y); break;
-    case 0xC3: DCP(idx_ind_x); break;
-    case 0xD3: DCP(ind_idx_y); break;
-    case 0xE7: ISC(zp); break;
-    case 0xF7: ISC(zp_x); break;
-    case 0xEF: ISC(abs); break;
-    case 0xFF: ISC(abs_x); break;
-    case 0xFB: ISC(abs_y); break;
-    case 0xE3: ISC(idx_ind_x); break;
-    case 0xF3: ISC(ind_idx_y); break;
-    case 0x07: SLO(zp); break;
-    case 0x17: SLO(zp_x); break;
-    case 0x0F: SLO(abs); break;
-    case 0x1F: SLO(abs_x); break;
-    case 0x1B: SLO(abs_y); break;
-    case 0x03: SLO(idx_ind_x); break;
-    case 0x13: SLO(ind_idx_y); break;
-    case 0x27: RLA(zp); break;
-    case 0x37: RLA(zp_x); break;
-    case 0x2F: RLA(abs); break;
-    case 0x3F: RLA(abs_x); break;
-    case 0x3B: RLA(abs_y); break;
-    case 0x23: RLA(idx_ind_x); break;
-    case 0x33: RLA(ind_idx_y); break;
-    case 0x67: RRA(zp); break;
-    case 0x77: RRA(zp_x); break;
-    case 0x6F: RRA(abs); break;
-    case 0x7F: RRA(abs_x); break;
-    case 0x7B: RRA(abs_y); break;
-    case 0x63: RRA(idx_ind_x); break;
-    case 0x73: RRA(ind_idx_y); break;
-    case 0x47: SRE(zp); break;
-    case 0x57: SRE(zp_x); break;
-    case 0x4F: SRE(abs); break;
-    case 0x5F: SRE(abs_x); break;
-    case 0x5B: SRE(abs_y); break;
-    case 0x43: SRE(idx_ind_x); break;
-    case 0x53: SRE(ind_idx_y); break;
-    case 0x4B: ALR(); break;
-    case 0x6B: ARR(); break;
-    case 0x0B:
-    case 0x2B: ANC(); break;
-    case 0x8B: ANE(); break;
-    case 0x9F: SHA(abs_y); break;
-    case 0x93: SHA(ind_idx_y); break;
-    case 0x9B: TAS(); break;
-    case 0x9E: SHX(); break;
-    case 0x9C: SHY(); break;
-    case 0xBB: LAS(); break;
-    /* 1-byte NOPs */
-    case 0x1A:
-    case 0x3A:
-    case 0x5A:
-    case 0x7A:
-    case 0xDA:
-    case 0xFA: cycles += 2; break;
-    /* 2-byte NOPs */
-    case 0x80:
-    case 0x82:
-    case 0x89:
-    case 0xC2:
-    case 0xE2:
-        PC++;
-        cycles += 2;
-        break;
-    case 0x04:
-    case 0x44:
-    case 0x64:
-        PC++;
-        cycles += 3;
-        break;
-    case 0x14:
-    case 0x34:
-    case 0x54:
-    case 0x74:
-    case 0xD4:
-    case 0xF4:
-        PC++;
-        cycles += 4;
-        break;
-    /* 3-byte NOPs */
-    case 0x0C:
-        PC += 2;
-        cycles += 4;
-        break;
-    /* Variable cycle count */
-    case 0x1C:
-    case 0x3C:
-    case 0x5C:
-    case 0x7C:
-    case 0xDC:
-    case 0xFC: NOP_absx(); break;
-    case 0x02:
-    case 0x12:
-    case 0x22:
-    case 0x32:
-    case 0x42:
-    case 0x52:
-    case 0x62:
-    case 0x72:
-    case 0x92:
-    case 0xB2:
-    case 0xD2:
-    case 0xF2: JAM(opcode); throw NES::JAM(); break;
-    default:
-        throw NES::InvalidOpcode();
-    }
-
-    if (NMI) {
+template <class Bus>
+void CPUCore<Bus>::reset() { interrupt(i_reset); }
+
+StatusRegister CPU::status() const {
+    StatusRegister p = P;
+    p.status = (P.status & 0x3C) | (n_result & 0x80) | (overflow << 6) |
+               ((z_result == 0) << 1) | carry;
+    return p;
+}
+
+void CPU::set_status(uint8_t value) {
+    P.status = value;
+    n_result = value;
+    z_result = ~value & 0x2;
+    carry = value & 0x1;
+    overflow = value & 0x40;
+}
+
+// Opcode -> handler call. Every entry is dispatched through
+// `CPUCore::op<code>`, with the addressing mode resolved at compile time.
+#define NES_CPU_OPCODES(OP) \
+    OP(0x00, BRK())            \
+    OP(0x01, ORA<idx_ind_x>()) \
+    OP(0x02, JAM())            \
+    OP(0x03, SLO<idx_ind_x>()) \
+    OP(0x04, NOP<zp>())        \
+    OP(0x05, ORA<zp>())        \
+    OP(0x06, ASL<zp>())        \
+    OP(0x07, SLO<zp>())        \
+    OP(0x08, PH(status()))     \
+    OP(0x09, ORA<imm>())       \
+    OP(0x0A, ASL_A())          \
+    OP(0x0B, ANC())            \
+    OP(0x0C, NOP<abs>())       \
+    OP(0x0D, ORA<abs>())       \
+    OP(0x0E, ASL<abs>())       \
+    OP(0x0F, SLO<abs>())       \
+    OP(0x10, BPL())            \
+    OP(0x11, ORA<ind_idx_y>()) \
+    OP(0x12, JAM())            \
+    OP(0x13, SLO<ind_idx_y>()) \
+    OP(0x14, NOP<zp_x>())      \
+    OP(0x15, ORA<zp_x>())      \
+    OP(0x16, ASL<zp_x>())      \
+    OP(0x17, SLO<zp_x>())      \
+    OP(0x18, CLC())            \
+    OP(0x19, ORA<abs_y>())     \
+    OP(0x1A, NOP())            \
+    OP(0x1B, SLO<abs_y>())     \
+    OP(0x1C, NOP<abs_x>())     \
+    OP(0x1D, ORA<abs_x>())     \
+    OP(0x1E, ASL<abs_x>())     \
+    OP(0x1F, SLO<abs_x>())     \
+    OP(0x20, JSR())            \
+    OP(0x21, AND<idx_ind_x>()) \
+    OP(0x22, JAM())            \
+    OP(0x23, RLA<idx_ind_x>()) \
+    OP(0x24, BIT<zp>())        \
+    OP(0x25, AND<zp>())        \
+    OP(0x26, ROL<zp>())        \
+    OP(0x27, RLA<zp>())        \
+    OP(0x28, PLP())            \
+    OP(0x29, AND<imm>())       \
+    OP(0x2A, ROL_A())          \
+    OP(0x2B, ANC())            \
+    OP(0x2C, BIT<abs>())       \
+    OP(0x2D, AND<abs>())       \
+    OP(0x2E, ROL<abs>())       \
+    OP(0x2F, RLA<abs>())       \
+    OP(0x30, BMI())            \
+    OP(0x31, AND<ind_idx_y>()) \
+    OP(0x32, JAM())            \
+    OP(0x33, RLA<ind_idx_y>()) \
+    OP(0x34, NOP<zp_x>())      \
+    OP(0x35, AND<zp_x>())      \
+    OP(0x36, ROL<zp_x>())      \
+    OP(0x37, RLA<zp_x>())      \
+    OP(0x38, SEC())            \
+    OP(0x39, AND<abs_y>())     \
+    OP(0x3A, NOP())            \
+    OP(0x3B, RLA<abs_y>())     \
+    OP(0x3C, NOP<abs_x>())     \
+    OP(0x3D, AND<abs_x>())     \
+    OP(0x3E, ROL<abs_x>())     \
+    OP(0x3F, RLA<abs_x>())     \
+    OP(0x40, RTI())            \
+    OP(0x41, EOR<idx_ind_x>()) \
+    OP(0x42, JAM())            \
+    OP(0x43, SRE<idx_ind_x>()) \
+    OP(0x44, NOP<zp>())        \
+    OP(0x45, EOR<zp>())        \
+    OP(0x46, LSR<zp>())        \
+    OP(0x47, SRE<zp>())        \
+    OP(0x48, PH(A))            \
+    OP(0x49, EOR<imm>())       \
+    OP(0x4A, LSR_A())          \
+    OP(0x4B, ALR())            \
+    OP(0x4C, JMP<abs>())       \
+    OP(0x4D, EOR<abs>())       \
+    OP(0x4E, LSR<abs>())       \
+    OP(0x4F, SRE<abs>())       \
+    OP(0x50, BVC())            \
+    OP(0x51, EOR<ind_idx_y>()) \
+    OP(0x52, JAM())            \
+    OP(0x53, SRE<ind_idx_y>()) \
+    OP(0x54, NOP<zp_x>())      \
+    OP(0x55, EOR<zp_x>())      \
+    OP(0x56, LSR<zp_x>())      \
+    OP(0x57, SRE<zp_x>())      \
+    OP(0x58, CLI())            \
+    OP(0x59, EOR<abs_y>())     \
+    OP(0x5A, NOP())            \
+    OP(0x5B, SRE<abs_y>())     \
+    OP(0x5C, NOP<abs_x>())     \
+    OP(0x5D, EOR<abs_x>())     \
+    OP(0x5E, LSR<abs_x>())     \
+    OP(0x5F, SRE<abs_x>())     \
+    OP(0x60, RTS())            \
+    OP(0x61, ADC<idx_ind_x>()) \
+    OP(0x62, JAM())            \
+    OP(0x63, RRA<idx_ind_x>()) \
+    OP(0x64, NOP<zp>())        \
+    OP(0x65, ADC<zp>())        \
+    OP(0x66, ROR<zp>())        \
+    OP(0x67, RRA<zp>())        \
+    OP(0x68, PL(A))            \
+    OP(0x69, ADC<imm>())       \
+    OP(0x6A, ROR_A())          \
+    OP(0x6B, ARR())            \
+    OP(0x6C, JMP<ind>())       \
+    OP(0x6D, ADC<abs>())       \
+    OP(0x6E, ROR<abs>())       \
+    OP(0x6F, RRA<abs>())       \
+    OP(0x70, BVS())            \
+    OP(0x71, ADC<ind_idx_y>()) \
+    OP(0x72, JAM())            \
+    OP(0x73, RRA<ind_idx_y>()) \
+    OP(0x74, NOP<zp_x>())      \
+    OP(0x75, ADC<zp_x>())      \
+    OP(0x76, ROR<zp_x>())      \
+    OP(0x77, RRA<zp_x>())      \
+    OP(0x78, SEI())            \
+    OP(0x79, ADC<abs_y>())     \
+    OP(0x7A, NOP())            \
+    OP(0x7B, RRA<abs_y>())     \
+    OP(0x7C, NOP<abs_x>())     \
+    OP(0x7D, ADC<abs_x>())     \
+    OP(0x7E, ROR<abs_x>())     \
+    OP(0x7F, RRA<abs_x>())     \
+    OP(0x80, NOP<imm>())       \
+    OP(0x81, ST<idx_ind_x>(A)) \
+    OP(0x82, NOP<imm>())       \
+    OP(0x83, SAX<idx_ind_x>()) \
+    OP(0x84, ST<zp>(Y))        \
+    OP(0x85, ST<zp>(A))        \
+    OP(0x86, ST<zp>(X))        \
+    OP(0x87, SAX<zp>())        \
+    OP(0x88, DE(Y))            \
+    OP(0x89, NOP<imm>())       \
+    OP(0x8A, T(X, A))          \
+    OP(0x8B, ANE())            \
+    OP(0x8C, ST<abs>(Y))       \
+    OP(0x8D, ST<abs>(A))       \
+    OP(0x8E, ST<abs>(X))       \
+    OP(0x8F, SAX<abs>())       \
+    OP(0x90, BCC())            \
+    OP(0x91, ST<ind_idx_y>(A)) \
+    OP(0x92, JAM())            \
+    OP(0x93, SHA<ind_idx_y>()) \
+    OP(0x94, ST<zp_x>(Y))      \
+    OP(0x95, ST<zp_x>(A))      \
+    OP(0x96, ST<zp_y>(X))      \
+    OP(0x97, SAX<zp_y>())      \
+    OP(0x98, T(Y, A))          \
+    OP(0x99, ST<abs_y>(A))     \
+    OP(0x9A, T(X, S))          \
+    OP(0x9B, TAS())            \
+    OP(0x9C, SHY())            \
+    OP(0x9D, ST<abs_x>(A))     \
+    OP(0x9E, SHX())            \
+    OP(0x9F, SHA<abs_y>())     \
+    OP(0xA0, LD<imm>(Y))       \
+    OP(0xA1, LD<idx_ind_x>(A)) \
+    OP(0xA2, LD<imm>(X))       \
+    OP(0xA3, LAX<idx_ind_x>()) \
+    OP(0xA4, LD<zp>(Y))        \
+    OP(0xA5, LD<zp>(A))        \
+    OP(0xA6, LD<zp>(X))        \
+    OP(0xA7, LAX<zp>())        \
+    OP(0xA8, T(A, Y))          \
+    OP(0xA9, LD<imm>(A))       \
+    OP(0xAA, T(A, X))          \
+    OP(0xAB, LXA())            \
+    OP(0xAC, LD<abs>(Y))       \
+    OP(0xAD, LD<abs>(A))       \
+    OP(0xAE, LD<abs>(X))       \
+    OP(0xAF, LAX<abs>())       \
+    OP(0xB0, BCS())            \
+    OP(0xB1, LD<ind_idx_y>(A)) \
+    OP(0xB2, JAM())            \
+    OP(0xB3, LAX<ind_idx_y>()) \
+    OP(0xB4, LD<zp_x>(Y))      \
+    OP(0xB5, LD<zp_x>(A))      \
+    OP(0xB6, LD<zp_y>(X))      \
+    OP(0xB7, LAX<zp_y>())      \
+    OP(0xB8, CLV())            \
+    OP(0xB9, LD<abs_y>(A))     \
+    OP(0xBA, T(S, X))          \
+    OP(0xBB, LAS())            \
+    OP(0xBC, LD<abs_x>(Y))     \
+    OP(0xBD, LD<abs_x>(A))     \
+    OP(0xBE, LD<abs_y>(X))     \
+    OP(0xBF, LAX<abs_y>())     \
+    OP(0xC0, CP<imm>(Y))       \
+    OP(0xC1, CMP<idx_ind_x>()) \
+    OP(0xC2, NOP<imm>())       \
+    OP(0xC3, DCP<idx_ind_x>()) \
+    OP(0xC4, CP<zp>(Y))        \
+    OP(0xC5, CMP<zp>())        \
+    OP(0xC6, DEC<zp>())        \
+    OP(0xC7, DCP<zp>())        \
+    OP(0xC8, IN(Y))            \
+    OP(0xC9, CMP<imm>())       \
+    OP(0xCA, DE(X))            \
+    OP(0xCB, SBX())            \
+    OP(0xCC, CP<abs>(Y))       \
+    OP(0xCD, CMP<abs>())       \
+    OP(0xCE, DEC<abs>())       \
+    OP(0xCF, DCP<abs>())       \
+    OP(0xD0, BNE())            \
+    OP(0xD1, CMP<ind_idx_y>()) \
+    OP(0xD2, JAM())            \
+    OP(0xD3, DCP<ind_idx_y>()) \
+    OP(0xD4, NOP<zp_x>())      \
+    OP(0xD5, CMP<zp_x>())      \
+    OP(0xD6, DEC<zp_x>())      \
+    OP(0xD7, DCP<zp_x>())      \
+    OP(0xD8, CLD())            \
+    OP(0xD9, CMP<abs_y>())     \
+    OP(0xDA, NOP())            \
+    OP(0xDB, DCP<abs_y>())     \
+    OP(0xDC, NOP<abs_x>())     \
+    OP(0xDD, CMP<abs_x>())     \
+    OP(0xDE, DEC<abs_x>())     \
+    OP(0xDF, DCP<abs_x>())     \
+    OP(0xE0, CP<imm>(X))       \
+    OP(0xE1, SBC<idx_ind_x>()) \
+    OP(0xE2, NOP<imm>())       \
+    OP(0xE3, ISC<idx_ind_x>()) \
+    OP(0xE4, CP<zp>(X))        \
+    OP(0xE5, SBC<zp>())        \
+    OP(0xE6, INC<zp>())        \
+    OP(0xE7, ISC<zp>())        \
+    OP(0xE8, IN(X))            \
+    OP(0xE9, SBC<imm>())       \
+    OP(0xEA, NOP())            \
+    OP(0xEB, USBC())           \
+    OP(0xEC, CP<abs>(X))       \
+    OP(0xED, SBC<abs>())       \
+    OP(0xEE, INC<abs>())       \
+    OP(0xEF, ISC<abs>())       \
+    OP(0xF0, BEQ())            \
+    OP(0xF1, SBC<ind_idx_y>()) \
+    OP(0xF2, JAM())            \
+    OP(0xF3, ISC<ind_idx_y>()) \
+    OP(0xF4, NOP<zp_x>())      \
+    OP(0xF5, SBC<zp_x>())      \
+    OP(0xF6, INC<zp_x>())      \
+    OP(0xF7, ISC<zp_x>())      \
+    OP(0xF8, SED())            \
+    OP(0xF9, SBC<abs_y>())     \
+    OP(0xFA, NOP())            \
+    OP(0xFB, ISC<abs_y>())     \
+    OP(0xFC, NOP<abs_x>())     \
+    OP(0xFD, SBC<abs_x>())     \
+    OP(0xFE, INC<abs_x>())     \
+    OP(0xFF, ISC<abs_x>())
+
+#if defined(__GNUC__) || defined(__clang__)
+// Inline the whole handler into each opcode specialization so every opcode
+// compiles to straight-line code.
+#define NES_CPU_OP_ATTR __attribute__((flatten))
+#define NES_CPU_NOINLINE __attribute__((noinline))
+// Dispatch through a label table (computed goto) instead of a switch.
+#define NES_CPU_COMPUTED_GOTO
+#else
+#define NES_CPU_OP_ATTR
+#define NES_CPU_NOINLINE
+#endif
+
+// Member templates of a class template can't be explicitly specialized, so
+// every `op<Op>` instantiation picks its handler call from a constexpr chain.
+#define NES_CPU_OP_CASE(code, call) \
+    if constexpr (Op == code) {     \
+        call;                       \
+    } else
+template <class Bus>
+template <uint8_t Op>
+NES_CPU_OP_ATTR void CPUCore<Bus>::op() {
+    NES_CPU_OPCODES(NES_CPU_OP_CASE) {}
+}
+#undef NES_CPU_OP_CASE
+
+#define NES_CPU_HANDLER(code, call) &CPUCore::op<code>,
+template <class Bus>
+const std::array<typename CPUCore<Bus>::Handler, 256> CPUCore<Bus>::handlers =
+    {NES_CPU_OPCODES(NES_CPU_HANDLER)};
+#undef NES_CPU_HANDLER
+
+template <class Bus>
+template <uint8_t Op>
+NES_CPU_OP_ATTR void CPUCore<Bus>::jit_op(CPUCore *cpu, const DecodedOp *op,
+                                          uint16_t pc) {
+    cpu->cur_op = op;
+    cpu->cur_pc = pc;
+    cpu->opcode = Op;
+    cpu->PC = pc + 1;
+    NES_PROFILE(cpu->profiler.access(pc, false));
+    NES_PROFILE(uint64_t start = cpu->cycles);
+    cpu->template op<Op>();
+    cpu->cycles += op_info[Op].cycles;
+    NES_PROFILE(cpu->profiler.instruction(cpu->location(pc), pc, Op,
+                                          cpu->cycles - start));
+}
+
+#define NES_CPU_JIT_HANDLER(code, call) &CPUCore::jit_op<code>,
+template <class Bus>
+const std::array<typename CPUCore<Bus>::JITHandler, 256>
+    CPUCore<Bus>::jit_handlers = {NES_CPU_OPCODES(NES_CPU_JIT_HANDLER)};
+#undef NES_CPU_JIT_HANDLER
+
+template <class Bus>
+void CPUCore<Bus>::step(const DecodedOp *next) {
+    jammed = false;
+    op_cycles = cycles;
+    cur_pc = PC;
+    cur_op = next;
+    opcode = next ? next->opcode : read(PC);
+    NES_PROFILE(if (next) profiler.access(PC, false));
+    PC++;
+    NES_PROFILE(uint64_t start = cycles);
+#ifdef NES_CPU_COMPUTED_GOTO
+#define NES_CPU_LABEL_ADDR(code, call) &&op_##code,
+#define NES_CPU_LABEL(code, call) \
+    op_##code : op<code>();       \
+    goto dispatched;
+    static const void *const dispatch[256] = {
+        NES_CPU_OPCODES(NES_CPU_LABEL_ADDR)};
+    goto *dispatch[opcode];
+    NES_CPU_OPCODES(NES_CPU_LABEL)
+#undef NES_CPU_LABEL_ADDR
+#undef NES_CPU_LABEL
+dispatched:
+#else
+    (this->*handlers[opcode])();
+#endif
+    cycles += op_info[opcode].cycles;
+
+    if (scheduler.next() <= timestamp()) handle_events();
+    NES_PROFILE(profiler.instruction(location(cur_pc), cur_pc, opcode,
+                                     cycles - start));
+}
+
+template <class Bus>
+NES_CPU_NOINLINE void CPUCore<Bus>::handle_events() {
+    Timestamp now = timestamp();
+    if (scheduler.pending(Scheduler::ev_nmi, now)) {
         NES_LOG("CPU") << "Handling NMI" << endl;
         interrupt(i_nmi);
     }
-    if (IRQ && !P.I) {
+    if (scheduler.pending(Scheduler::ev_irq, now) && !P.I) {
         NES_LOG("CPU") << "Handling IRQ" << endl;
         interrupt(i_irq);
     }
+    // The DMA unit halts the CPU before the next instruction's opcode fetch
+    if (scheduler.pending(Scheduler::ev_dma, now)) handle_dma();
+}
+
+template <class Bus>
+uint16_t CPUCore<Bus>::execute() {
+    uint64_t initial_cyc = cycles;
+    step(decoded(PC));
+    if (jammed) throw NES::JAM();
+    return cycles - initial_cyc;
+}
+
+template <class Bus>
+void CPUCore<Bus>::execute_jit_op() {
+    uint16_t pc = PC;
+    DecodedOp op = {read(pc, true),
+                    {read(pc + 1, true), read(pc + 2, true)},
+                    true,
+                    false};
+    jit_handlers[op.opcode](this, &op, pc);
+    // Not a cached instruction, don't keep pointing at it
+    cur_op = nullptr;
+}
+
+template <class Bus>
+CPU::RunResult CPUCore<Bus>::run(uint32_t budget) {
+    uint64_t initial_cyc = cycles;
+    uint16_t prev_pc = PC;
+    uint64_t prev_start = cycles;
+    const DecodedOp *next = decoded(PC);
+    do {
+        uint16_t pc = PC;
+        uint64_t start = cycles;
+        step(next);
+        if (jammed) return {uint32_t(cycles - initial_cyc), run_jam};
+        // Loops end with a backward jump
+        if (PC <= pc)
+            skip_idle_loop(pc, start, prev_pc, prev_start,
+                           initial_cyc + budget);
+        prev_pc = pc;
+        prev_start = start;
+        next = decoded(PC);
+    } while (cycles - initial_cyc <= budget);
+    return {uint32_t(cycles - initial_cyc), run_ok};
+}
+
+template <class Bus>
+void CPUCore<Bus>::skip_idle_loop(uint16_t pc, uint64_t start,
+                                  uint16_t prev_pc, uint64_t prev_start,
+                                  uint64_t end) {
+    // Events change the flow of execution
+    if (scheduler.next() != Scheduler::never) return;
+    const DecodedOp *jump = decoded(pc);
+    if (!jump) return;
+    bool branch = op_info[jump->opcode].mode == rel;
+    if (!branch && jump->opcode != 0x4C) return;
+
+    uint64_t loop_start;
+    if (PC == pc) {
+        // Jump to self, nothing changes until an event
+        loop_start = start;
+    } else {
+        // Load and branch back to it, the load has to return the same value
+        // on every iteration
+        const DecodedOp *load = PC == prev_pc ? decoded(prev_pc) : nullptr;
+        if (!branch || !load || prev_pc + op_info[load->opcode].len != pc ||
+            !poll_loops(*load, jump->opcode))
+            return;
+        loop_start = prev_start;
+    }
 
-    return cycles > initial_cyc
-               ? cycles - initial_cyc
-               : numeric_limits<uint32_t>::max() - initial_cyc + cycles;
+    // Every iteration takes the same cycles, skip the ones whose last
+    // instruction starts within the budget
+    uint64_t loop_cyc = cycles - loop_start;
+    uint64_t last_start = start - loop_start;
+    if (cycles + last_start > end) return;
+    uint64_t iterations = (end - cycles - last_start) / loop_cyc + 1;
+    NES_LOG("CPU") << "Idle loop at 0x" << hex << PC << ", skipping " << dec
+                   << iterations << " iterations" << endl;
+    cycles += iterations * loop_cyc;
+    NES_PROFILE(profiler.idle(location(pc), iterations * loop_cyc));
+}
+
+template <class Bus>
+bool CPUCore<Bus>::poll_loops(const DecodedOp &load, uint8_t branch) {
+    enum { ld, bit, cmp } kind;
+    uint8_t reg = 0x0;  // Register compared against, loads test for 0
+    switch (load.opcode) {
+    case 0xA4:  // LDY zp
+    case 0xA5:  // LDA zp
+    case 0xA6:  // LDX zp
+    case 0xAC:  // LDY abs
+    case 0xAD:  // LDA abs
+    case 0xAE:  // LDX abs
+        kind = ld;
+        break;
+    case 0x24:  // BIT zp
+    case 0x2C:  // BIT abs
+        kind = bit;
+        break;
+    case 0xC5:  // CMP zp
+    case 0xCD:  // CMP abs
+        kind = cmp;
+        reg = A;
+        break;
+    case 0xE4:  // CPX zp
+    case 0xEC:  // CPX abs
+        kind = cmp;
+        reg = X;
+        break;
+    case 0xC4:  // CPY zp
+    case 0xCC:  // CPY abs
+        kind = cmp;
+        reg = Y;
+        break;
+    default: return false;
+    }
+    uint16_t addr = op_info[load.opcode].mode == zp
+                        ? load.operand[0]
+                        : load.operand[0] | (load.operand[1] << 8);
+    uint8_t value = bus->read(addr, true);
+
+    // Branch opcodes select the flag with bits 6-7 and the value to branch
+    // on with bit 5
+    bool flag;
+    uint8_t needed;  // Bits of value the flag depends on
+    switch (branch >> 6) {
+    case 0:  // N
+        flag = kind == cmp ? (reg - value) & 0x80 : value & 0x80;
+        needed = kind == cmp ? 0xFF : 0x80;
+        break;
+    case 1:  // V
+        flag = kind == bit ? value & 0x40 : overflow;
+        needed = kind == bit ? 0x40 : 0x0;
+        break;
+    case 2:  // C
+        flag = kind == cmp ? reg >= value : carry;
+        needed = kind == cmp ? 0xFF : 0x0;
+        break;
+    default:  // Z
+        flag = kind == bit ? !(A & value) : value == reg;
+        needed = kind == bit ? A : 0xFF;
+        break;
+    }
+    return (bus->stable_bits(addr) & needed) == needed &&
+           flag == bool(branch & 0x20);
 }
 
-void CPU::interrupt(NES::Interrupt type) {
+template <class Bus>
+NES_CPU_NOINLINE void CPUCore<Bus>::interrupt(NES::Interrupt type) {
     if (type != i_reset) {
         NES_LOG("CPU") << "Push to stack PC"
              << " H: " << hex << (unsigned int)(uint8_t)(PC >> 8)
              << " L: " << hex << (unsigned int)(uint8_t)PC << endl;
         NES_LOG("CPU") << "Push to stack P: " << hex
-             << (type == i_brk ? P.status | 0x10 : P.status) << endl;
+             << (type == i_brk ? status().status | 0x10 : status().status)
+             << endl;
         PH((uint8_t)(PC >> 8), false);
         PH((uint8_t)PC, false);
-        PH(type == i_brk ? P.status | 0x10 : P.status, false);
+        PH(type == i_brk ? status().status | 0x10 : status().status, false);
     } else {
         NES_LOG("CPU") << "P |= 0x04" << endl;
         P.status |= 0x04;
@@ -445,25 +678,38 @@ void CPU::interrupt(NES::Interrupt type) {
     }
 
     NES_LOG("CPU") << "New PC: 0x" << hex << (unsigned int)PC << endl;
+#ifdef NES_ENABLE_PROFILER
+    // Handlers start after the 7 interrupt cycles
+    if (type == i_reset)
+        profiler.entry(location(PC));
+    else
+        profiler.call(location(cur_pc), location(PC), S, cycles + 7);
+#endif
 
     if (type == i_nmi)
-        NMI = false;
+        scheduler.cancel(Scheduler::ev_nmi);
     else if (type == i_irq)
-        IRQ = false;
+        scheduler.cancel(Scheduler::ev_irq);
 
-    cycles += 7;
+    // BRK cycles are counted through `op_info`
+    if (type != i_brk) cycles += 7;
     NES_LOG("CPU") << "Interrupt handler finish" << endl;
 }
 
-uint8_t CPU::read(uint16_t addr, bool passive) {
-    switch (dma) {
-    case DMA_OAM:
-    case DMA_PCM: handle_dma();
-    default: return bus->read(addr, passive);
-    }
+template <class Bus>
+uint8_t CPUCore<Bus>::read(uint16_t addr, bool passive) {
+    NES_PROFILE(profiler.access(addr, false));
+    return bus->read(addr, passive);
 }
 
-uint16_t CPU::read16(uint16_t addr, bool zp, bool passive) {
+template <class Bus>
+void CPUCore<Bus>::dummy_read(uint16_t addr, bool passive) {
+    NES_PROFILE(profiler.dummy_read());
+    read(addr, passive);
+}
+
+template <class Bus>
+uint16_t CPUCore<Bus>::read16(uint16_t addr, bool zp, bool passive) {
     // If we know this is a zero-page addr, wrap the most-significant bit
     // around zero-page bounds
     uint16_t h_addr = zp ? ((addr + 1) % 0x100) : (addr + 1);
@@ -472,17 +718,32 @@ uint16_t CPU::read16(uint16_t addr, bool zp, bool passive) {
     return (h_data << 8) | l_data;
 }
 
-void CPU::write(uint16_t addr, uint8_t value) { bus->write(addr, value); }
+template <class Bus>
+void CPUCore<Bus>::write(uint16_t addr, uint8_t value) {
+    NES_PROFILE(profiler.access(addr, true));
+    bus->write(addr, value);
+}
 
 void CPU::schedule_dma_oam(uint8_t page) {
     NES_LOG("CPU") << "schedule_dma_oam page: " << (uint16_t)page << endl;
     dma = DMA_OAM;
     dma_page = page;
+    scheduler.schedule(Scheduler::ev_dma, timestamp());
 }
 
-void CPU::schedule_nmi() { NMI = true; }
+void CPU::schedule_nmi() {
+    scheduler.schedule(Scheduler::ev_nmi, timestamp());
+}
+
+void CPU::set_irq(bool asserted) {
+    if (asserted)
+        scheduler.schedule(Scheduler::ev_irq, timestamp());
+    else
+        scheduler.cancel(Scheduler::ev_irq);
+}
 
-void CPU::handle_dma() {
+template <class Bus>
+NES_CPU_NOINLINE void CPUCore<Bus>::handle_dma() {
     if (dma == DMA_PCM) {
         throw runtime_error("PCM DMA unimplemented");
     } else if (dma == DMA_OAM) {
@@ -491,169 +752,257 @@ void CPU::handle_dma() {
             NES_LOG("CPU") << "DMA OAM: odd cycle, wait one cycle" << endl;
             cycles++;
         }
-        uint8_t i = 0;
-        do {
-            uint8_t data = bus->read((dma_page << 8) | i);
-            NES_LOG("CPU") << "DMA OAM: read at 0x" << hex
-                 << (unsigned int)((dma_page << 8) | i)
-                 << ", data: 0x" << hex << (unsigned int)data
-                 << ", write to OAMDATA" << endl;
-            cycles++;
-            bus->write(0x2004, data);
-            cycles++;
-            i++;
-        } while (i != 0);
+        if (bus->dma_oam(dma_page)) {
+            // RAM and ROM pages are copied in one go, a read and a write cycle
+            // per byte
+            NES_LOG("CPU") << "DMA OAM: block copy" << endl;
+            cycles += 2 * 0x100;
+        } else {
+            uint8_t i = 0;
+            do {
+                uint8_t data = bus->read((dma_page << 8) | i, false);
+                NES_LOG("CPU") << "DMA OAM: read at 0x" << hex
+                     << (unsigned int)((dma_page << 8) | i)
+                     << ", data: 0x" << hex << (unsigned int)data
+                     << ", write to OAMDATA" << endl;
+                cycles++;
+                bus->write(0x2004, data);
+                cycles++;
+                i++;
+            } while (i != 0);
+        }
         NES_LOG("CPU") << "DMA OAM: End" << endl;
 
         // TODO: PCM DMA can interrupt OAM DMA
 
         dma = DMA_Clear;
+        scheduler.cancel(Scheduler::ev_dma);
     }
 }
 
-uint8_t CPU::get_operand(AddressingMode mode) {
-    return read(operand_addr(mode));
+// PRG ROM instruction cache
+
+template <class Bus>
+void CPUCore<Bus>::attach_prg_cache() {
+    prg_mapper = bus->mapper;
+    prg_cache.clear();
+    prg_window.fill(-1);
+    if (!prg_mapper) return;
+    prg_cache.resize(prg_mapper->cartridge.prg_rom.size(), DecodedOp{});
+    prg_mapper->on_prg_bank_switch.push_back(
+        [this]() { update_prg_windows(); });
+    update_prg_windows();
+}
+
+template <class Bus>
+void CPUCore<Bus>::update_prg_windows() {
+    for (size_t w = 0; w < prg_window.size(); w++) {
+        int32_t offset = prg_mapper->prg_rom_offset(0x8000 + w * prg_window_sz);
+        // Windows which aren't fully backed by PRG ROM go through the bus
+        if (offset < 0 || (size_t)offset + prg_window_sz > prg_cache.size())
+            offset = -1;
+        prg_window[w] = offset;
+    }
 }
 
-bool CPU::is_same_page(uint16_t addr, uint16_t addr2) {
-    return (addr & 0xFF00) == (addr2 & 0xFF00);
+template <class Bus>
+uint32_t CPUCore<Bus>::location(uint16_t addr) {
+    if (bus->mapper != prg_mapper) attach_prg_cache();
+    int32_t window =
+        addr < 0x8000 ? -1 : prg_window[(addr - 0x8000) / prg_window_sz];
+    return window < 0 ? addr
+                      : Profiler::rom_base + window + addr % prg_window_sz;
+}
+
+template <class Bus>
+const typename CPUCore<Bus>::DecodedOp *CPUCore<Bus>::decoded(uint16_t addr) {
+    if (bus->mapper != prg_mapper) attach_prg_cache();
+    // Code running from RAM, PRG RAM or registers is never cached
+    if (addr < 0x8000) return nullptr;
+    int32_t window = prg_window[(addr - 0x8000) / prg_window_sz];
+    uint16_t i = addr % prg_window_sz;
+    // Cached instructions never span windows
+    if (window < 0 || i > prg_window_sz - 3) return nullptr;
+    DecodedOp *op = &prg_cache[window + i];
+    if (!op->valid) decode_block(window + i, window + prg_window_sz - 2);
+    return op;
+}
+
+template <class Bus>
+void CPUCore<Bus>::decode_block(uint32_t offset, uint32_t end) {
+    const vector<uint8_t> &rom = prg_mapper->cartridge.prg_rom;
+    while (offset < end && !prg_cache[offset].valid) {
+        DecodedOp &op = prg_cache[offset];
+        op.opcode = rom[offset];
+        op.operand[0] = rom[offset + 1];
+        op.operand[1] = rom[offset + 2];
+        op.valid = true;
+        op.memory_only =
+            op_memory_only(op.opcode, op.operand[0] | (op.operand[1] << 8));
+        if (op_transfers_control(op.opcode)) return;
+        offset += op_info[op.opcode].len;
+    }
 }
 
-bool CPU::idx_abs_crossing_cycle(uint8_t opcode) {
-    uint8_t incr_ops[] = {
-        0x7D, 0x79, 0x3D, 0x39, 0xDD, 0xD9, 0x5D, 0x59, 0xBD, 0xB9,
-        0xBE, 0xBC, 0x1D, 0x19, 0xFD, 0xF9, 0xBF, 0x1C, 0x3C, 0x5C,
-        0x7C, 0xDC, 0xFC, 0xC9, 0xBF, 0xB3, 0xBD, 0xB9, 0xB1,
-    };
-    size_t size = sizeof(incr_ops) / sizeof(uint8_t);
-    return find(incr_ops, incr_ops + size, opcode) != (incr_ops + size);
+template <class Bus>
+uint8_t CPUCore<Bus>::fetch(uint16_t addr) {
+    uint16_t i = addr - cur_pc - 1;
+    if (cur_op && i < 2 &&
+        (i + 1 < op_info[opcode].len || bus->stable_bits(addr) == 0xFF)) {
+        NES_PROFILE(profiler.access(addr, false));
+        return cur_op->operand[i];
+    }
+    return read(addr);
+}
+
+template <class Bus>
+uint16_t CPUCore<Bus>::fetch16(uint16_t addr) {
+    uint8_t l_data = fetch(addr);
+    uint8_t h_data = fetch(addr + 1);
+    return (h_data << 8) | l_data;
+}
+
+template <class Bus>
+template <AddressingMode M>
+uint8_t CPUCore<Bus>::get_operand() {
+    if constexpr (M == imm)
+        return fetch(operand_addr<M>());
+    else
+        return read(operand_addr<M>());
 }
 
-uint16_t CPU::operand_addr(AddressingMode mode) {
+bool CPU::is_same_page(uint16_t addr, uint16_t addr2) {
+    return (addr & 0xFF00) == (addr2 & 0xFF00);
+}
+
+template <class Bus>
+template <AddressingMode M>
+uint16_t CPUCore<Bus>::operand_addr() {
+    static_assert(M != rel && M != ind && M != acc && M != impl,
+                  "No operand address for this addressing mode");
     uint16_t addr = 0x0; 
     uint8_t addr_h, addr_l = 0x0;
     uint8_t i = 0x0;
     // Some of the reads are strictly to model bus accesses to satisfy nes6502
     // single-instruction CPU tests, but when executing actual software can
     // trigger undesired side effects
-    switch (mode) {
-    case abs:
-        addr = read16(PC);
+    if constexpr (M == abs) {
+        addr = fetch16(PC);
         PC += 2;
-        break;
-    case abs_x:
-        addr_l = read(PC);
-        addr_h = read(PC+1);
+    } else if constexpr (M == abs_x) {
+        addr_l = fetch(PC);
+        addr_h = fetch(PC+1);
         addr = ((addr_h << 8) | addr_l) + X;
         if (!is_same_page(addr-X, addr))
-            read((addr_h << 8) | (uint8_t)(addr_l + X), !test_mode);
+            dummy_read((addr_h << 8) | (uint8_t)(addr_l + X), !test_mode);
         else {
-            read(addr, !test_mode);
+            dummy_read(addr, !test_mode);
         }
         PC += 2;
-        if (idx_abs_crossing_cycle(opcode) && !is_same_page(addr - X, addr))
+        if (op_info[opcode].page_penalty && !is_same_page(addr - X, addr)) {
             cycles++;
-        break;
-    case abs_y:
-        addr_l = read(PC);
-        addr_h = read(PC+1);
+            NES_PROFILE(profiler.page_crossing(opcode));
+        }
+    } else if constexpr (M == abs_y) {
+        addr_l = fetch(PC);
+        addr_h = fetch(PC+1);
         addr = ((addr_h << 8) | addr_l) + Y;
         if (!is_same_page(addr-Y, addr))
-            read((addr_h << 8) | (uint8_t)(addr_l + Y), !test_mode);
+            dummy_read((addr_h << 8) | (uint8_t)(addr_l + Y), !test_mode);
         else
-            read(addr, !test_mode);
+            dummy_read(addr, !test_mode);
         PC += 2;
-        if (idx_abs_crossing_cycle(opcode) && !is_same_page(addr - Y, addr))
+        if (op_info[opcode].page_penalty && !is_same_page(addr - Y, addr)) {
             cycles++;
-        break;
-    case imm:
+            NES_PROFILE(profiler.page_crossing(opcode));
+        }
+    } else if constexpr (M == imm) {
         addr = PC;
         PC++;
-        break;
-    case zp:
-        addr = read(PC);
+    } else if constexpr (M == zp) {
+        addr = fetch(PC);
         PC++;
-        break;
-    case zp_x:
-        i = read(PC);
-        read(i);
+    } else if constexpr (M == zp_x) {
+        i = fetch(PC);
+        dummy_read(i);
         addr = (i + X) % 0x100;
         PC++;
-        break;
-    case zp_y:
-        i = read(PC);
-        read(i);
+    } else if constexpr (M == zp_y) {
+        i = fetch(PC);
+        dummy_read(i);
         addr = (i + Y) % 0x100;
         PC++;
-        break;
-    case idx_ind_x:
-        i = read(PC);
-        read(i);
+    } else if constexpr (M == idx_ind_x) {
+        i = fetch(PC);
+        dummy_read(i);
         addr_l = read((i+X) % 0x100);
         addr_h = read((i+X+1) % 0x100);
         addr = (addr_h << 8) | addr_l;
         PC++;
-        break;
-    case ind_idx_y:
-        i = read(PC);
+    } else if constexpr (M == ind_idx_y) {
+        i = fetch(PC);
         addr_l = read(i);
         addr_h = read((uint16_t)(uint8_t)(i+1));
         addr = ((addr_h << 8) | addr_l) + Y;
         if (!is_same_page(addr - Y, addr))
-            read((addr_h << 8) | (uint8_t)(addr_l + Y), !test_mode);
+            dummy_read((addr_h << 8) | (uint8_t)(addr_l + Y), !test_mode);
         else
-            read(addr, !test_mode);
+            dummy_read(addr, !test_mode);
         PC++;
-        if (idx_abs_crossing_cycle(opcode) && !is_same_page(addr - Y, addr))
+        if (op_info[opcode].page_penalty && !is_same_page(addr - Y, addr)) {
             cycles++;
-        break;
-    case ind:
-    default: NES_LOG("CPU") << "Invalid addressing mode: " << hex << int(mode) << endl;
+            NES_PROFILE(profiler.page_crossing(opcode));
+        }
     }
     return addr;
 }
 
 // Auxiliary
 
-uint8_t CPU::rot_l(uint8_t value) {
-    bool last_C = P.C;
-    P.C = bool(value & 0x80);
+template <class Bus>
+uint8_t CPUCore<Bus>::rot_l(uint8_t value) {
+    bool last_C = carry;
+    carry = bool(value & 0x80);
     uint8_t output = value << 1 | last_C;
     set_NZ(output);
     return output;
 }
 
-uint8_t CPU::rot_r(uint8_t value) {
-    bool last_C = P.C;
-    P.C = bool(value & 1);
+template <class Bus>
+uint8_t CPUCore<Bus>::rot_r(uint8_t value) {
+    bool last_C = carry;
+    carry = bool(value & 1);
     uint8_t output = last_C << 7 | value >> 1;
     set_NZ(output);
     return output;
 }
 
-uint8_t CPU::shift_l(uint8_t value) {
-    P.C = bool(value & 0x80);
+template <class Bus>
+uint8_t CPUCore<Bus>::shift_l(uint8_t value) {
+    carry = bool(value & 0x80);
     uint8_t output = (uint8_t)(value << 1);
     set_NZ(output);
     return output;
 }
 
-uint8_t CPU::shift_r(uint8_t value) {
-    P.C = bool(uint8_t(value << 7));
+template <class Bus>
+uint8_t CPUCore<Bus>::shift_r(uint8_t value) {
+    carry = bool(uint8_t(value << 7));
     uint8_t output = (uint8_t)(value >> 1);
     set_NZ(output);
     return output;
 }
 
-void CPU::do_ADC(uint8_t operand) {
+template <class Bus>
+void CPUCore<Bus>::do_ADC(uint8_t operand) {
     // ADC/SBC implementation:
     // https://stackoverflow.com/questions/29193303/6502-emulation-proper-way-to-implement-adc-and-sbc
     // Overflow on signed arithmetic:
     // http://www.6502.org/tutorials/vflag.html
     // In decimal mode treat operands as binary-coded decimals.
     // TODO: Not sure if additional handling is needed for decimals?
-    uint16_t sum = A + operand + P.C;
-    P.C = sum > 0xFF;
+    uint16_t sum = A + operand + carry;
+    carry = sum > 0xFF;
 
     // Two-complements overflow happens when the result value is outside of
     // the [-128, 127] range. This is equivalent to when two operands with
@@ -664,25 +1013,28 @@ void CPU::do_ADC(uint8_t operand) {
     // >> 7			Shift the most significant bit to least
     //			significant position and cast to bool so we
     //			we don't have a type-related warning.
-    P.V = (bool)((~(A ^ operand) & (A ^ sum) & 0x80) >> 7);
+    overflow = (bool)((~(A ^ operand) & (A ^ sum) & 0x80) >> 7);
     A = (uint8_t)sum;
     set_NZ(A);
 }
 
-void CPU::set_NZ(uint8_t value) {
-    P.Z = value == 0;
-    P.N = (bool)(value & 0x80);
+template <class Bus>
+void CPUCore<Bus>::set_NZ(uint8_t value) {
+    n_result = value;
+    z_result = value;
 }
 
-void CPU::BRK() {
-    read(PC++);
+template <class Bus>
+void CPUCore<Bus>::BRK() {
+    fetch(PC++);
     interrupt(i_brk);
 }
 
 // Branch instructions
 
-void CPU::branch_rel() {
-    uint8_t op = get_operand(imm);
+template <class Bus>
+void CPUCore<Bus>::branch_rel() {
+    uint8_t op = get_operand<imm>();
     uint8_t pc_h = uint8_t((PC & 0xFF00) >> 8);
     uint8_t pc_l = uint8_t(PC & 0xFF);
     bool page_crossing = uint16_t(pc_l) + op >= 0x100;
@@ -695,38 +1047,48 @@ void CPU::branch_rel() {
     }
     if (((PC & 0xFF00) >> 8) != pc_h) {
         cycles += 2;
+        NES_PROFILE(profiler.page_crossing(opcode));
     } else {
         cycles++;
     }
 }
 
-#define branch_rel_if(expr) \
-    {                       \
-        cycles += 2;        \
-        if (expr)           \
-            branch_rel();   \
-        else                \
-            PC++;           \
+#define branch_rel_if(expr)                          \
+    {                                                \
+        bool taken = expr;                           \
+        NES_PROFILE(profiler.branch(opcode, taken)); \
+        if (taken)                                   \
+            branch_rel();                            \
+        else                                         \
+            PC++;                                    \
     }
 
-void CPU::BPL() { branch_rel_if(!P.N) }
-void CPU::BMI() { branch_rel_if(P.N) }
-void CPU::BVC() { branch_rel_if(!P.V) }
-void CPU::BVS() { branch_rel_if(P.V) }
-void CPU::BCC() { branch_rel_if(!P.C) }
-void CPU::BCS() { branch_rel_if(P.C) }
-void CPU::BNE() { branch_rel_if(!P.Z) }
-void CPU::BEQ() { branch_rel_if(P.Z) }
+template <class Bus>
+void CPUCore<Bus>::BPL() { branch_rel_if(!(n_result & 0x80)) }
+template <class Bus>
+void CPUCore<Bus>::BMI() { branch_rel_if(n_result & 0x80) }
+template <class Bus>
+void CPUCore<Bus>::BVC() { branch_rel_if(!overflow) }
+template <class Bus>
+void CPUCore<Bus>::BVS() { branch_rel_if(overflow) }
+template <class Bus>
+void CPUCore<Bus>::BCC() { branch_rel_if(!carry) }
+template <class Bus>
+void CPUCore<Bus>::BCS() { branch_rel_if(carry) }
+template <class Bus>
+void CPUCore<Bus>::BNE() { branch_rel_if(z_result) }
+template <class Bus>
+void CPUCore<Bus>::BEQ() { branch_rel_if(!z_result) }
 
 // Control transfer
 
-void CPU::JMP(AddressingMode mode) {
-    switch (mode) {
-    case abs:
-        PC = read16(PC);
-        cycles += 3;
-        break;
-    case ind:
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::JMP() {
+    static_assert(M == abs || M == ind, "Invalid addressing mode for JMP");
+    if constexpr (M == abs) {
+        PC = fetch16(PC);
+    } else {
         // Vector beginning on a last byte of a page will take
         // the high byte of the address from the beginning of
         // the same page rather than the next one.
@@ -736,491 +1098,363 @@ void CPU::JMP(AddressingMode mode) {
         // JMP ($30FF) will transfer control to $4080 rather
         // than $5080.
         uint16_t h_addr, l_addr;
-        l_addr = read16(PC);
+        l_addr = fetch16(PC);
         h_addr = (l_addr % 0x100 == 0xFF) ? (uint16_t)(l_addr - l_addr % 0x100)
                                           : (uint16_t)(l_addr + 1);
         l_addr = read(l_addr);
         h_addr = read(h_addr);
         PC = (uint16_t)h_addr << 8 | l_addr;
-        cycles += 5;
-        break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for JMP: " << mode << endl;
     }
 }
 
-void CPU::JSR() {
+template <class Bus>
+void CPUCore<Bus>::JSR() {
     // JSR return address should be the last byte of the 3-byte JSR instr.
     uint8_t addr_l, addr_h = 0x0;
     uint16_t return_addr = (uint16_t)(PC + 1);
 
-    addr_l = read(PC);
+    addr_l = fetch(PC);
 
-    read((uint16_t)(0x100 + S));
+    dummy_read((uint16_t)(0x100 + S));
     write((uint16_t)(0x100 + S), (uint8_t)(return_addr >> 8));
     S--;
     write((uint16_t)(0x100 + S), (uint8_t)return_addr);
     S--;
     
-    addr_h = read(PC+1);
+    addr_h = fetch(PC+1);
 
     PC = ((uint16_t)addr_h << 8) | addr_l;
-    cycles += 6;
+    NES_PROFILE(profiler.call(location(cur_pc), location(PC), S,
+                              cycles + op_info[0x20].cycles));
 }
 
-void CPU::RTS() {
+template <class Bus>
+void CPUCore<Bus>::RTS() {
+    NES_PROFILE(profiler.ret(S, cycles + op_info[0x60].cycles));
     uint8_t l_addr, h_addr;
-    read(PC);
-    read((uint16_t)(0x100 + S));
+    fetch(PC);
+    dummy_read((uint16_t)(0x100 + S));
     S++;
     l_addr = read((uint16_t)(0x100 + S));
     S++;
     h_addr = read((uint16_t)(0x100 + S));
-    read(h_addr << 8 | l_addr);
+    dummy_read(h_addr << 8 | l_addr);
     PC = (h_addr << 8 | l_addr) + 0x1;
-    cycles += 6;
 }
 
-void CPU::RTI() {
+template <class Bus>
+void CPUCore<Bus>::RTI() {
+    NES_PROFILE(profiler.ret(S, cycles + op_info[0x40].cycles));
     uint8_t l_addr, h_addr;
-    read(PC);
-    read((uint16_t)(0x100 + S));
+    fetch(PC);
+    dummy_read((uint16_t)(0x100 + S));
     S++;
     uint8_t newp = read((uint16_t)(0x100 + S));
-    P.N = bool(newp & 0x80);
-    P.V = bool(newp & 0x40);
-    P.D = bool(newp & 0x8);
-    P.I = bool(newp & 0x4);
-    P.Z = bool(newp & 0x2);
-    P.C = bool(newp & 0x1);
+    set_status((P.status & 0x30) | (newp & 0xCF));
     S++;
     l_addr = read((uint16_t)(0x100 + S));
     S++;
     h_addr = read((uint16_t)(0x100 + S));
     PC = (h_addr << 8 | l_addr);
-    cycles += 6;
 }
 
 // Arithmetic / logical
 
-void CPU::ADC(AddressingMode mode) {
-    uint16_t op_addr = operand_addr(mode);
-    do_ADC(read(op_addr));
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for ADC" << endl;
-    }
-}
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ADC() { do_ADC(get_operand<M>()); }
 
-void CPU::AND(AddressingMode mode) {
-    A &= get_operand(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::AND() {
+    A &= get_operand<M>();
     set_NZ(A);
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for AND" << endl;
-    }
 }
 
-void CPU::ASL_A() {
+template <class Bus>
+void CPUCore<Bus>::ASL_A() {
     A = shift_l(A);
-    cycles += 2;
 }
 
-void CPU::ASL(AddressingMode mode) {
-    uint16_t addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ASL() {
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     write(addr, op);
     write(addr, shift_l(op));
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for ASL" << endl;
-    }
 }
 
-void CPU::BIT(AddressingMode mode) {
-    uint8_t operand = get_operand(mode);
-    P.Z = (A & operand) == 0;
-    P.V = (bool)((operand >> 6) & 1);
-    P.N = (bool)((operand >> 7) & 1);
-    if (mode == zp)
-        cycles += 3;
-    else if (mode == abs)
-        cycles += 4;
-}
-
-void CPU::CMP(AddressingMode mode) { CP(A, mode); }
-
-void CPU::CP(const uint8_t &reg, AddressingMode mode) {
-    uint8_t operand = get_operand(mode);
-    P.Z = reg == operand;
-    P.C = reg >= operand;
-    P.N = (bool)((reg - operand) & 0x80);
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for CPx" << endl;
-    }
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::BIT() {
+    uint8_t operand = get_operand<M>();
+    z_result = A & operand;
+    overflow = (bool)((operand >> 6) & 1);
+    n_result = operand;
+}
+
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::CMP() { CP<M>(A); }
+
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::CP(const uint8_t &reg) {
+    uint8_t operand = get_operand<M>();
+    carry = reg >= operand;
+    set_NZ(reg - operand);
 }
 
-void CPU::DEC(AddressingMode mode) {
-    uint16_t op_addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::DEC() {
+    uint16_t op_addr = operand_addr<M>();
     uint8_t op = read(op_addr);
     uint8_t result = op - 1;
     write(op_addr, op);
     write(op_addr, result);
     set_NZ(result);
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for DEC" << endl;
-    }
 }
 
-void CPU::EOR(AddressingMode mode) {
-    uint8_t operand = get_operand(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::EOR() {
+    uint8_t operand = get_operand<M>();
     A ^= operand;
     set_NZ(A);
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for EOR" << endl;
-    }
 }
 
 #define set_status_flag(flag, value) \
     {                                \
         P.flag = value;              \
-        cycles += 2;                 \
     }
 
-void CPU::CLC() set_status_flag(C, false);
-void CPU::SEC() set_status_flag(C, true);
-void CPU::CLI() set_status_flag(I, false);
-void CPU::SEI() set_status_flag(I, true);
-void CPU::CLV() set_status_flag(V, false);
-void CPU::CLD() set_status_flag(D, false);
-void CPU::SED() set_status_flag(D, true);
-
-void CPU::LSR_A() {
+template <class Bus>
+void CPUCore<Bus>::CLC() { carry = false; }
+template <class Bus>
+void CPUCore<Bus>::SEC() { carry = true; }
+template <class Bus>
+void CPUCore<Bus>::CLI() set_status_flag(I, false);
+template <class Bus>
+void CPUCore<Bus>::SEI() set_status_flag(I, true);
+template <class Bus>
+void CPUCore<Bus>::CLV() { overflow = false; }
+template <class Bus>
+void CPUCore<Bus>::CLD() set_status_flag(D, false);
+template <class Bus>
+void CPUCore<Bus>::SED() set_status_flag(D, true);
+
+template <class Bus>
+void CPUCore<Bus>::LSR_A() {
     A = shift_r(A);
-    cycles += 2;
 }
 
-void CPU::LSR(AddressingMode mode) {
-    uint16_t addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::LSR() {
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     uint8_t result = shift_r(op);
     write(addr, op);
     write(addr, result);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for LSR" << endl;
-    }
 }
 
-void CPU::ORA(AddressingMode mode) {
-    uint8_t operand = get_operand(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ORA() {
+    uint8_t operand = get_operand<M>();
     A |= operand;
     set_NZ(A);
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for CPx" << endl;
-    }
 }
 
-void CPU::ROL_A() {
+template <class Bus>
+void CPUCore<Bus>::ROL_A() {
     A = rot_l(A);
-    cycles += 2;
 }
 
-void CPU::ROL(AddressingMode mode) {
-    uint16_t addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ROL() {
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     write(addr, op);
     write(addr, rot_l(op));
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for ROL" << endl;
-    }
 }
 
-void CPU::ROR_A() {
+template <class Bus>
+void CPUCore<Bus>::ROR_A() {
     A = rot_r(A);
-    cycles += 2;
 }
 
-void CPU::ROR(AddressingMode mode) {
-    uint16_t addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ROR() {
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     write(addr, op);
     write(addr, rot_r(op));
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for ROR" << endl;
-    }
 }
 
-void CPU::SBC(AddressingMode mode) {
-    uint16_t op_addr = operand_addr(mode);
-    do_ADC(~read(op_addr));
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for SBC" << endl;
-    }
-}
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::SBC() { do_ADC(~get_operand<M>()); }
 
-void CPU::USBC() { SBC(imm); }
+template <class Bus>
+void CPUCore<Bus>::USBC() { SBC<imm>(); }
 
 // Load / store
 
-void CPU::LD(uint8_t &reg, AddressingMode mode) {
-    uint8_t operand = get_operand(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::LD(uint8_t &reg) {
+    uint8_t operand = get_operand<M>();
     reg = operand;
     set_NZ(operand);
-    switch (mode) {
-    case imm: cycles += 2; break;
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case zp_y: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for LDx" << endl;
-    }
 }
 
-void CPU::ST(uint8_t reg, AddressingMode mode) {
-    uint16_t op_addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ST(uint8_t reg) {
+    uint16_t op_addr = operand_addr<M>();
     write(op_addr, reg);
-    switch (mode) {
-    case zp: cycles += 3; break;
-    case zp_x: cycles += 4; break;
-    case zp_y: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_x:
-    case abs_y: cycles += 5; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 6; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for STx" << endl;
-    }
 }
 
-void CPU::INC(AddressingMode mode) {
-    uint16_t addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::INC() {
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     auto result = (uint8_t)(op + 1);
     write(addr, op);
     write(addr, result);
     set_NZ(result);
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for INC" << endl;
-    }
 }
 
 // Register
 
-void CPU::T(uint8_t &reg_from, uint8_t &reg_to) {
+template <class Bus>
+void CPUCore<Bus>::T(uint8_t &reg_from, uint8_t &reg_to) {
     reg_to = reg_from;
-    cycles += 2;
     if (addressof(reg_from) == addressof(X) &&
         addressof(reg_to) == addressof(S))
         return;
     set_NZ(reg_from);
 }
 
-void CPU::DE(uint8_t &reg) {
+template <class Bus>
+void CPUCore<Bus>::DE(uint8_t &reg) {
     reg--;
     set_NZ(reg);
-    cycles += 2;
 }
 
-void CPU::IN(uint8_t &reg) {
+template <class Bus>
+void CPUCore<Bus>::IN(uint8_t &reg) {
     reg++;
     set_NZ(reg);
-    cycles += 2;
 }
 
 // Stack
 
-void CPU::PH(uint8_t value, uint8_t do_read) {
+template <class Bus>
+void CPUCore<Bus>::PH(uint8_t value, uint8_t do_read) {
     if (do_read)
-        read(PC);
+        fetch(PC);
     write((uint16_t)(0x100 + S), value);
     S--;
-    cycles += 3;
 }
 
-void CPU::PH(const StatusRegister &p) {
-    read(PC);
+template <class Bus>
+void CPUCore<Bus>::PH(const StatusRegister &p) {
+    fetch(PC);
     write((uint16_t)(0x100 + S), (uint8_t)(p.status | 0x10));
     S--;
-    cycles += 3;
 }
 
-void CPU::PL(uint8_t &reg_to) {
-    read(PC);
-    read(0x100 + S);
+template <class Bus>
+void CPUCore<Bus>::PL(uint8_t &reg_to) {
+    fetch(PC);
+    dummy_read(0x100 + S);
     S++;
     uint8_t operand = read((uint16_t)(0x100 + S));
     reg_to = operand;
-    if (&reg_to != &P.status) set_NZ(operand);
-    cycles += 4;
+    set_NZ(operand);
 }
 
-void CPU::PL(StatusRegister &p) {
-    read(PC);
-    read(0x100 + S);
+template <class Bus>
+void CPUCore<Bus>::PLP() {
+    fetch(PC);
+    dummy_read(0x100 + S);
     S++;
     uint8_t newp = read((uint16_t)(0x100 + S));
-    p.N = bool(newp & 0x80);
-    p.V = bool(newp & 0x40);
-    p.D = bool(newp & 0x8);
-    p.I = bool(newp & 0x4);
-    p.Z = bool(newp & 0x2);
-    p.C = bool(newp & 0x1);
-
-    cycles += 4;
+    set_status((P.status & 0x30) | (newp & 0xCF));
 }
 
-void CPU::NOP_absx() {
-    get_operand(abs_x);
-    cycles += 4;
+template <class Bus>
+void CPUCore<Bus>::NOP() {}
+
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::NOP() {
+    if constexpr (M == abs_x)
+        get_operand<abs_x>();
+    else
+        PC += op_len(M) - 1;
 }
 
-void CPU::LAX(AddressingMode mode) {
-    uint8_t operand = get_operand(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::LAX() {
+    uint8_t operand = get_operand<M>();
     A = operand;
     X = operand;
     set_NZ(operand);
-    switch (mode) {
-    case zp: cycles += 3; break;
-    case zp_y: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case abs_y: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    case ind_idx_y: cycles += 5; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for LAX" << endl;
-    }
 }
 
-void CPU::LXA() {
-    uint8_t op = get_operand(imm);
+template <class Bus>
+void CPUCore<Bus>::LXA() {
+    uint8_t op = get_operand<imm>();
     A = (A | 0xEE) & op;
     X = A;
     set_NZ(A);
-    cycles += 2;
 }
 
-void CPU::SAX(AddressingMode mode) {
-    uint16_t op_addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::SAX() {
+    uint16_t op_addr = operand_addr<M>();
     write(op_addr, A & X);
-    switch (mode) {
-    case zp: cycles += 3; break;
-    case zp_y: cycles += 4; break;
-    case abs: cycles += 4; break;
-    case idx_ind_x: cycles += 6; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for SAX" << endl;
-    }
 }
 
-void CPU::SBX() { // AXS
+template <class Bus>
+void CPUCore<Bus>::SBX() { // AXS
     // Another op with weird behaviour. Disabled tests
-    uint8_t op = get_operand(imm);
+    uint8_t op = get_operand<imm>();
     X = (A & X) - op;
 
-    P.Z = X == 0;
-    P.C = X >= 0;
-    P.N = (bool)(X & 0x80);
+    carry = X >= 0;
+    set_NZ(X);
 
-    cycles += 2;
 }
 
-void CPU::DCP(AddressingMode mode) {
-    uint16_t op_addr = operand_addr(mode);
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::DCP() {
+    uint16_t op_addr = operand_addr<M>();
     uint8_t op = read(op_addr);
     uint8_t result = op - 1;
     write(op_addr, op);
     write(op_addr, result);
 
-    P.Z = A == result;
-    P.C = A >= result;
-    P.N = bool((A - result) & 0x80);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    case abs_y: cycles += 7; break;
-    case idx_ind_x: cycles += 8; break;
-    case ind_idx_y: cycles += 8; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for DCP" << endl;
-    }
+    carry = A >= result;
+    set_NZ(A - result);
 }
 
-void CPU::ISC(AddressingMode mode) {
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::ISC() {
     // INC
-    uint16_t op_addr = operand_addr(mode);
+    uint16_t op_addr = operand_addr<M>();
     uint8_t op = read(op_addr);
     uint8_t result = op + 1;
     write(op_addr, op);
@@ -1229,22 +1463,13 @@ void CPU::ISC(AddressingMode mode) {
 
     // SBC
     do_ADC(~result);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    case abs_y: cycles += 7; break;
-    case idx_ind_x: cycles += 8; break;
-    case ind_idx_y: cycles += 8; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for ISC (ISB, INS)" << endl;
-    }
 }
 
-void CPU::SLO(AddressingMode mode) {
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::SLO() {
     // ASL
-    uint16_t addr = operand_addr(mode);
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     uint8_t result = shift_l(op);
     write(addr, op);
@@ -1253,22 +1478,13 @@ void CPU::SLO(AddressingMode mode) {
     // ORA
     A |= result;
     set_NZ(A);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    case abs_y: cycles += 7; break;
-    case idx_ind_x: cycles += 8; break;
-    case ind_idx_y: cycles += 8; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for SLO/ASO" << endl;
-    }
 }
 
-void CPU::RLA(AddressingMode mode) {
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::RLA() {
     // ROL
-    uint16_t addr = operand_addr(mode);
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     uint8_t result = rot_l(op);
     write(addr, op);
@@ -1277,22 +1493,13 @@ void CPU::RLA(AddressingMode mode) {
     // AND
     A &= result;
     set_NZ(A);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    case abs_y: cycles += 7; break;
-    case idx_ind_x: cycles += 8; break;
-    case ind_idx_y: cycles += 8; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for SLO/ASO" << endl;
-    }
 }
 
-void CPU::SRE(AddressingMode mode) {
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::SRE() {
     // LSR
-    uint16_t addr = operand_addr(mode);
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     uint8_t result = shift_r(op);
     write(addr, op);
@@ -1301,22 +1508,13 @@ void CPU::SRE(AddressingMode mode) {
     // EOR
     A ^= result;
     set_NZ(A);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    case abs_y: cycles += 7; break;
-    case idx_ind_x: cycles += 8; break;
-    case ind_idx_y: cycles += 8; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for SRE" << endl;
-    }
 }
 
-void CPU::RRA(AddressingMode mode) {
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::RRA() {
     // ROR
-    uint16_t addr = operand_addr(mode);
+    uint16_t addr = operand_addr<M>();
     uint8_t op = read(addr);
     uint8_t result = rot_r(op);
     write(addr, op);
@@ -1324,67 +1522,54 @@ void CPU::RRA(AddressingMode mode) {
 
     // ADC
     do_ADC(result);
-
-    switch (mode) {
-    case zp: cycles += 5; break;
-    case zp_x: cycles += 6; break;
-    case abs: cycles += 6; break;
-    case abs_x: cycles += 7; break;
-    case abs_y: cycles += 7; break;
-    case idx_ind_x: cycles += 8; break;
-    case ind_idx_y: cycles += 8; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for RRA" << endl;
-    }
 }
 
-void CPU::ALR() {
-    A &= get_operand(imm);
-    P.C = (bool)(A & 0x1);
+template <class Bus>
+void CPUCore<Bus>::ALR() {
+    A &= get_operand<imm>();
+    carry = (bool)(A & 0x1);
     A = shift_r(A);
     set_NZ(A);
-    cycles += 2;
 }
 
-void CPU::ARR() { 
-    uint8_t op = get_operand(imm);
+template <class Bus>
+void CPUCore<Bus>::ARR() { 
+    uint8_t op = get_operand<imm>();
     A &= op;
-    A = P.C << 7 | A >> 1;
+    A = carry << 7 | A >> 1;
     set_NZ(A);
-    P.C = bool((A >> 6) & 0x1);
-    P.V = bool(P.C ^ ((A >> 5) & 0x1));
-    cycles += 2;
+    carry = bool((A >> 6) & 0x1);
+    overflow = bool(carry ^ ((A >> 5) & 0x1));
 }
 
-void CPU::ANC() {
-    AND(imm);
-    P.C = (bool)(A & 0x80);
+template <class Bus>
+void CPUCore<Bus>::ANC() {
+    AND<imm>();
+    carry = (bool)(A & 0x80);
 }
 
-void CPU::ANE() { // XAA
-    uint8_t op = get_operand(imm);
+template <class Bus>
+void CPUCore<Bus>::ANE() { // XAA
+    uint8_t op = get_operand<imm>();
     A = (A | 0xEE) & X & op;
     set_NZ(A);
 }
 
-void CPU::SHA(AddressingMode mode) {
+template <class Bus>
+template <AddressingMode M>
+void CPUCore<Bus>::SHA() {
     // TODO: Missing behaviour, disabled tests for this. Attempt to model
     // unstability below in TAS 
     // unstable: sometimes 'AND (H+1)' is dropped, page boundary crossings may 
     // not work (with the high-byte of the value used as the high-byte of the 
     // address)
-    uint16_t addr = operand_addr(mode);
+    uint16_t addr = operand_addr<M>();
     uint8_t result = A & X & ((addr >> 8) + 1);
     write(addr, result); 
-    switch (mode) {
-    case abs_y:
-        cycles += 5; break;
-    case ind_idx_y:
-        cycles += 6; break;
-    default: NES_LOG("CPU") << "Invalid addressing mode for SHA" << endl;
-    }
 }
 
-void CPU::TAS() { // XAS / SHS
+template <class Bus>
+void CPUCore<Bus>::TAS() { // XAS / SHS
     // TODO: Disabled tests, not sure if I can satisfy them
     // unstable: sometimes 'AND (H+1)' is dropped, page boundary crossings may 
     // not work (with the high-byte of the value used as the high-byte of the 
@@ -1395,13 +1580,13 @@ void CPU::TAS() { // XAS / SHS
     uint16_t addr;
     uint8_t addr_l, addr_h;
     uint8_t result;
-    addr_l = read(PC);
-    addr_h = read(PC+1);
+    addr_l = fetch(PC);
+    addr_h = fetch(PC+1);
     addr = ((addr_h << 8) | addr_l) + Y;
     if (!is_same_page(addr-Y, addr))
-        read((addr_h << 8) | (uint8_t)(addr_l+Y));
+        dummy_read((addr_h << 8) | (uint8_t)(addr_l+Y));
     else
-        read(addr);
+        dummy_read(addr);
     PC += 2;
 
     result = A & X & ((addr >> 8) + 1);
@@ -1411,22 +1596,22 @@ void CPU::TAS() { // XAS / SHS
         addr = (result << 8) | (uint8_t)addr;
 
     write(addr, result);
-    cycles += 5;
 }
 
-void CPU::SHX() {
+template <class Bus>
+void CPUCore<Bus>::SHX() {
     // Unstable as above
     // abs_y
     uint16_t addr;
     uint8_t addr_l, addr_h;
     uint8_t result;
-    addr_l = read(PC);
-    addr_h = read(PC+1);
+    addr_l = fetch(PC);
+    addr_h = fetch(PC+1);
     addr = ((addr_h << 8) | addr_l) + Y;
     if (!is_same_page(addr-Y, addr))
-        read((addr_h << 8) | (uint8_t)(addr_l+Y));
+        dummy_read((addr_h << 8) | (uint8_t)(addr_l+Y));
     else
-        read(addr);
+        dummy_read(addr);
     PC += 2;
 
     result = X & ((addr >> 8) + 1);
@@ -1435,22 +1620,22 @@ void CPU::SHX() {
         addr = (result << 8) | (uint8_t)addr;
 
     write(addr, result);
-    cycles += 5;
 }
 
-void CPU::SHY() {
+template <class Bus>
+void CPUCore<Bus>::SHY() {
     // Unstable as above
     // abs_x
     uint16_t addr;
     uint8_t addr_l, addr_h;
     uint8_t result;
-    addr_l = read(PC);
-    addr_h = read(PC+1);
+    addr_l = fetch(PC);
+    addr_h = fetch(PC+1);
     addr = ((addr_h << 8) | addr_l) + X;
     if (!is_same_page(addr-X, addr))
-        read((addr_h << 8) | (uint8_t)(addr_l+X));
+        dummy_read((addr_h << 8) | (uint8_t)(addr_l+X));
     else
-        read(addr);
+        dummy_read(addr);
     PC += 2;
 
     result = Y & ((addr >> 8) + 1);
@@ -1459,36 +1644,42 @@ void CPU::SHY() {
         addr = (result << 8) | (uint8_t)addr;
 
     write(addr, result);
-    cycles += 5;
 }
 
-void CPU::LAS() {
+template <class Bus>
+void CPUCore<Bus>::LAS() {
     //uint16_t addr = operand_addr(abs_y);
     //uint8_t operand = read(addr);
 
     // abs_y
-    uint8_t addr_l = read(PC);
-    uint8_t addr_h = read(PC+1);
+    uint8_t addr_l = fetch(PC);
+    uint8_t addr_h = fetch(PC+1);
     uint16_t addr = ((addr_h << 8) | addr_l) + Y;
     PC += 2;
-    if (idx_abs_crossing_cycle(opcode) && !is_same_page(addr - Y, addr))
+    if (op_info[opcode].page_penalty && !is_same_page(addr - Y, addr)) {
         cycles++;
+        NES_PROFILE(profiler.page_crossing(opcode));
+    }
     uint8_t operand = read(addr);
     S &= operand;
     A = X = S;
     set_NZ(A);
-    cycles += 4;
 }
 
-void CPU::JAM(uint8_t opcode) {
-    read(PC);
-    read(0xffff); 
-    read(0xfffe); 
-    read(0xfffe); 
-    read(0xffff); 
-    read(0xffff); 
-    read(0xffff); 
-    read(0xffff); 
-    read(0xffff); 
-    read(0xffff); 
+template <class Bus>
+void CPUCore<Bus>::JAM() {
+    fetch(PC);
+    dummy_read(0xffff); 
+    dummy_read(0xfffe); 
+    dummy_read(0xfffe); 
+    dummy_read(0xffff); 
+    dummy_read(0xffff); 
+    dummy_read(0xffff); 
+    dummy_read(0xffff); 
+    dummy_read(0xffff); 
+    dummy_read(0xffff); 
+    jammed = true;
 }
+
+template class NES::CPUCore<NES::MemoryBus>;
+template class NES::CPUCore<NES::Test::MemoryBus>;
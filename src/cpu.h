@@ -2,12 +2,26 @@
 #define INC_2A03_CPU_H
 
 #include <bitfield.h>
+#include <profiler.h>
+#include <scheduler.h>
 
+#include <array>
 #include <cstdint>
+#include <vector>
 
 namespace NES {
 
-class MemoryBusIntf;
+class MemoryBus;
+
+namespace Test {
+class MemoryBus;
+}
+
+namespace iNESv1 {
+namespace Mapper {
+class Base;
+}
+}  // namespace iNESv1
 
 /// Addressing mode for an operation.
 enum AddressingMode {
@@ -21,7 +35,9 @@ enum AddressingMode {
     zp_y,       ///< Zero Page indexed with Y.
     idx_ind_x,  ///< Indexed indirect with X.
     ind_idx_y,  ///< Indirect indexed with Y.
-    ind         ///< Indirect.
+    ind,        ///< Indirect.
+    acc,        ///< Accumulator.
+    impl        ///< Implied.
 };
 
 /// Interrupt type.
@@ -44,44 +60,81 @@ bitfield_union(StatusRegister, uint8_t status,
                                ///< result value.
 );
 
-/// Ricoh 2A03 CPU emulator. CPU state is invalid until `power` is
-/// called.
+/// Ricoh 2A03 CPU state. The emulation itself is implemented by `CPUCore`,
+/// which is specialized for the concrete bus it runs on. CPU state is
+/// invalid until `power` is called.
 class CPU {
    public:
-    NES::MemoryBusIntf *bus;
-
     uint8_t A;         ///< Accumulator
     uint8_t X, Y;      ///< Index registers
     uint16_t PC;       ///< Program counter
     uint8_t S;         ///< Stack pointer
-    StatusRegister P;  ///< Status register
-    bool IRQ;          ///< Interrupt line. Setting to true will trigger an
-                       ///< IRQ after next instruction completes.
-    bool NMI;  ///< Non-maskable interrupt line. Setting to true will trigger an
-               ///< IRQ after next instruction completes.
-    uint32_t cycles;  ///< Cycle counter.
+    uint64_t cycles;  ///< Cycle counter, see `timestamp`.
+    /// Cycle counter when the current instruction started, see
+    /// `op_timestamp`.
+    uint64_t op_cycles = 0;
     uint8_t opcode; ///< Current opcode.
+    /// Pending NMI, IRQ and DMA. Events due at the current cycle are handled
+    /// after the next instruction completes.
+    Scheduler scheduler;
+    /// Guest code profile since power up, collected if the profiler is
+    /// compiled in, see `NES_PROFILE`.
+    Profiler profiler;
 
     bool test_mode = false;  ///< Makes internal operand address reads active
 
-    CPU(NES::MemoryBusIntf *bus);
+    /// Reason `run` returned.
+    enum RunStatus {
+        run_ok,   ///< Budget used up.
+        run_jam,  ///< A JAM opcode halted the CPU.
+    };
+
+    /// Result of `run`.
+    struct RunResult {
+        uint32_t cycles;   ///< Cycles executed.
+        RunStatus status;  ///< Reason execution stopped.
+    };
+
+    virtual ~CPU() = default;
+
+    /// Returns the master clock timestamp the CPU has run up to.
+    Timestamp timestamp() const { return cycles * cpu_cycle_ticks; }
+
+    /// Returns the master clock timestamp the current instruction started
+    /// at. Devices caught up to it during the instruction see the same state
+    /// as if they were synchronized before it.
+    Timestamp op_timestamp() const { return op_cycles * cpu_cycle_ticks; }
 
-    /// Does crossing the page boundary result in an additional cycle for
-    /// this opcode
-    static bool idx_abs_crossing_cycle(uint8_t opcode);
+    /// Returns the status register. N, Z, C and V are evaluated lazily, so
+    /// the register is assembled on every call.
+    StatusRegister status() const;
+
+    /// Sets the status register.
+    void set_status(uint8_t value);
 
     /// Returns `true` if addr and addr2 are on the same page.
     static bool is_same_page(uint16_t addr, uint16_t addr2);
 
     /// Starts the CPU.
-    void power();
+    virtual void power() = 0;
 
     /// Resets the CPU.
-    void reset();
+    virtual void reset() = 0;
 
     /// Executes the next instruction.
     /// \return Cycles executed
-    uint16_t execute();
+    /// \throw JAM if a JAM opcode halted the CPU.
+    virtual uint16_t execute() = 0;
+
+    /// Executes instructions back to back until the budget is used up, at
+    /// least one. The bus catches devices up to `op_timestamp` before they
+    /// observe an access, so they see the same state as with `execute`.
+    /// Idle loops are fast-forwarded to the end of the budget.
+    /// \param budget Cycles which can elapse before the last instruction
+    /// starts. Has to end before the PPU next sets vblank, which also raises
+    /// the NMI, as polled registers are assumed not to change until then.
+    /// \return Cycles executed and the reason execution stopped.
+    virtual RunResult run(uint32_t budget) = 0;
 
     /// Schedules a DMA transfer
     /// \value page Page to copy
@@ -90,7 +143,18 @@ class CPU {
     /// Schledules an NMI after the next instruction cycles finish
     void schedule_nmi();
 
+    /// Sets the IRQ line. While asserted, an IRQ is triggered after every
+    /// instruction which completes with interrupts enabled.
+    void set_irq(bool asserted);
+
    protected:
+    /// Status register. Only I, D and B are up to date, see `status`.
+    StatusRegister P;
+    uint8_t n_result;  ///< N is bit 7 of the last result.
+    uint8_t z_result;  ///< Z is set if the last result is 0.
+    bool carry;        ///< C flag.
+    bool overflow;     ///< V flag.
+
     enum DMAState {
         DMA_Clear,
         DMA_OAM,
@@ -100,12 +164,147 @@ class CPU {
     DMAState dma = DMA_Clear;  ///< Is DMA scheduled/in progress
     uint8_t dma_page = 0x0;    ///< Page to transfer
 
+    CPU();
+};
+
+/// Ricoh 2A03 CPU emulator running on the bus type `Bus`. Bus accesses are
+/// direct calls, so they can be inlined into the instruction handlers.
+/// Instantiated in cpu.cpp for `NES::MemoryBus` and `NES::Test::MemoryBus`.
+template <class Bus>
+class CPUCore final : public CPU {
+    friend class JIT;
+
+   public:
+    Bus *bus;
+
+    explicit CPUCore(Bus *bus);
+
+    void power() override;
+
+    void reset() override;
+
+    uint16_t execute() override;
+
+    RunResult run(uint32_t budget) override;
+
+    /// Executes the instruction at PC through its JIT entry, the way
+    /// translated code does. The instruction is predecoded with passive
+    /// reads, so tests can check the entries against the interpreter.
+    void execute_jit_op();
+
+   protected:
+    /// Opcode handler, see `op`.
+    using Handler = void (CPUCore::*)();
+
+    /// Handlers for every opcode, indexed by opcode.
+    static const std::array<Handler, 256> handlers;
+
+    /// Executes the opcode `Op`. Defined for every opcode in cpu.cpp.
+    template <uint8_t Op>
+    void op();
+
     /// Handle DMA transfer
     void handle_dma();
 
+    /// Handles the events in `scheduler` which are due.
+    void handle_events();
+
+    /// Instruction predecoded from PRG ROM.
+    struct DecodedOp {
+        uint8_t opcode;      ///< Opcode byte.
+        uint8_t operand[2];  ///< The two bytes following the opcode.
+        bool valid;          ///< Entry has been decoded.
+        bool memory_only;    ///< See `op_memory_only`.
+    };
+
+    static const uint16_t prg_window_sz = 0x2000;  ///< Cache window - 8KB.
+
+    /// Decoded instructions indexed by PRG ROM offset. Entries only depend on
+    /// ROM contents, so they stay valid across bank switches.
+    std::vector<DecodedOp> prg_cache;
+    /// PRG ROM offset of every 8KB window in $8000-$FFFF, -1 if not cached.
+    std::array<int32_t, 4> prg_window = {-1, -1, -1, -1};
+    /// Mapper `prg_cache` has been built for.
+    iNESv1::Mapper::Base *prg_mapper = nullptr;
+    const DecodedOp *cur_op = nullptr;  ///< Current instruction if cached.
+    uint16_t cur_pc = 0x0;              ///< Current instruction address.
+
+    /// Rebuilds the PRG ROM cache for the mapper currently on the bus.
+    void attach_prg_cache();
+
+    /// Updates `prg_window` after a PRG bank switch.
+    void update_prg_windows();
+
+    /// Returns the cached instruction at addr, decoding it and the
+    /// straight-line code following it on a miss.
+    /// \return Cached instruction or nullptr if addr isn't cacheable.
+    const DecodedOp *decoded(uint16_t addr);
+
+    /// Decodes instructions starting at the provided PRG ROM offset until a
+    /// control transfer, an already decoded entry or the end offset.
+    /// \param offset PRG ROM offset to start decoding at.
+    /// \param end PRG ROM offset to stop decoding at.
+    void decode_block(uint32_t offset, uint32_t end);
+
+    /// Returns the profiler location of the instruction at addr.
+    uint32_t location(uint16_t addr);
+
+    /// Reads a byte of the current instruction, using the cached instruction
+    /// when possible. Dummy reads of the bytes after the operand only skip
+    /// the bus when it reports them as unobservable, see `stable_bits`.
+    uint8_t fetch(uint16_t addr);
+
+    /// Reads 2 bytes of the current instruction.
+    uint16_t fetch16(uint16_t addr);
+
+    bool jammed = false;  ///< The last instruction was a JAM.
+
+    /// Executes the next instruction, along with pending DMA and interrupts.
+    /// \param next Cached instruction at PC, see `decoded`.
+    void step(const DecodedOp *next);
+
+    /// Fast-forwards through an idle loop ending with the instruction just
+    /// executed: a jump to self, or a load or compare polling memory or a
+    /// register followed by a branch back to it. Iterations are skipped
+    /// while they provably do the same thing, which ends when an event
+    /// happens or the polled bits change. The loop is left at its first
+    /// instruction, which always executes for real next.
+    /// \param pc Address of the instruction just executed.
+    /// \param start Cycle that instruction started at.
+    /// \param prev_pc Address of the instruction before it.
+    /// \param prev_start Cycle that instruction started at.
+    /// \param end Cycle the last skipped instruction has to start at or
+    /// before, see `run`.
+    void skip_idle_loop(uint16_t pc, uint64_t start, uint16_t prev_pc,
+                        uint64_t prev_start, uint64_t end);
+
+    /// Returns `true` if the load keeps returning a value which makes the
+    /// branch following it go back to the load.
+    /// \param load Load, BIT or compare instruction reading memory.
+    /// \param branch Branch opcode.
+    bool poll_loops(const DecodedOp &load, uint8_t branch);
+
+    /// Translated code entry, see `jit_op`.
+    using JITHandler = void (*)(CPUCore *cpu, const DecodedOp *op,
+                                uint16_t pc);
+
+    /// JIT entries for every opcode, indexed by opcode.
+    static const std::array<JITHandler, 256> jit_handlers;
+
+    /// Executes the opcode `Op` the way `execute` does, without interrupt
+    /// handling. Called from code generated by `JIT`.
+    /// \param op Cached instruction.
+    /// \param pc Address of the instruction.
+    template <uint8_t Op>
+    static void jit_op(CPUCore *cpu, const DecodedOp *op, uint16_t pc);
+
     /// Attempt to read byte from bus at addr
     uint8_t read(uint16_t addr, bool passive = false);
 
+    /// Reads a byte whose value the instruction discards, modelling the bus
+    /// access of a cycle spent on something else.
+    void dummy_read(uint16_t addr, bool passive = false);
+
     /// Attempt to read 2 bytes from bus
     /// \param addr Address to read from
     /// \param zp If it's a zero-page addr, wrap the most significant byte
@@ -125,16 +324,18 @@ class CPU {
 
     /// Returns the address of the parameter based on the addressing
     /// mode and increments PC based on param length.
-    /// \param mode Addressing mode.
+    /// \tparam M Addressing mode.
     /// \return Parameter address.
-    uint16_t operand_addr(AddressingMode mode);
+    template <AddressingMode M>
+    uint16_t operand_addr();
 
     /// Retrieves the current instruction parameter based on
     /// the addressing mode and increments PC based on parameter
     /// length.
-    /// \param mode Addressing mode to use.
+    /// \tparam M Addressing mode to use.
     /// \return Parameter for current instruction.
-    uint8_t get_operand(AddressingMode mode);
+    template <AddressingMode M>
+    uint8_t get_operand();
 
     // Auxiliary functions
 
@@ -205,8 +406,9 @@ class CPU {
     // Control transfer
 
     /// Transfer program execution.
-    /// \param mode Addressing mode to use.
-    void JMP(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void JMP();
 
     /// Jump to subroutine. Pushes the address - 1 of next op on the
     /// stack before transfering control.
@@ -223,12 +425,14 @@ class CPU {
     // Arithmetic / logical
 
     /// Add with carry.
-    /// \param mode Addressing mode to use.
-    void ADC(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void ADC();
 
     /// Bitwise AND with accumulator.
-    /// \param mode Addressing mode to use.
-    void AND(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void AND();
 
     /// Arithmetic shift left with accumulator. 0 is shifted into
     /// bit 0 and the original bit 7 is shifted into Carry.
@@ -236,34 +440,40 @@ class CPU {
 
     /// Arithmetic shift left. 0 is shifted into bit 0 and the
     /// original bit 7 is shifted into Carry.
-    /// \param mode Addressing mode to use.
-    void ASL(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void ASL();
 
     /// Test if one or more bits are set in a target memory
     /// location. Effectively ANDs with the accumulator which should
     /// contain a mask pattern. Affects N, V, Z.
-    /// \param mode Addressing mode to use.
-    void BIT(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void BIT();
 
     /// Compare accumulator. Sets flags as if subtraction had been
     /// carried out. If A >= operand, sets C. N will be set based
     /// on the sign of result and equality of the operand.
-    /// \param mode Addressing mode to use.
-    void CMP(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void CMP();
 
     /// Compare register. Sets flags as if subtraction had been
     /// carried out. If A >= operand, sets C. N will be set based
     /// on the sign of result and equality of the operand.
     /// \param reg Register to compare to.
-    /// \param mode Addressing mode to use.
-    void CP(const uint8_t &reg, AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void CP(const uint8_t &reg);
 
     /// Decrement memory. Affects N, Z.
-    /// \param mode Addressing mode to use.
-    void DEC(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void DEC();
 
     /// Bitwise XOR. Affects N, Z.
-    void EOR(AddressingMode mode);
+    template <AddressingMode M>
+    void EOR();
 
     /// Clear carry flag.
     void CLC();
@@ -292,46 +502,54 @@ class CPU {
 
     /// Logical shift right. 0 is shifted into bit 7 and the
     /// original bit 0 is shifted into Carry.
-    /// \param mode Addressing mode to use.
-    void LSR(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void LSR();
 
     /// Performs bitwise OR with the accumulator.
-    /// \param mode Addressing mode to use.
-    void ORA(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void ORA();
 
     /// Rotate left the accumulator.
     void ROL_A();
 
     /// Rotate left a value at the specified address.
-    /// \param mode Addressing mode to use.
-    void ROL(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void ROL();
 
     /// Rotate right the accumulator.
     void ROR_A();
 
     /// Rotate right a value at the specified address.
-    /// \param mode Addressing mode to use.
-    void ROR(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void ROR();
 
     /// Subtract with carry.
-    /// \param mode Addressing mode to use.
-    void SBC(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void SBC();
 
     // Load / store
 
     /// Load register with memory.
     /// \param reg Register address to load memory to.
-    /// \param addr_fn Addressing mode to use.
-    void LD(uint8_t &reg, AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void LD(uint8_t &reg);
 
     /// Store register.
     /// \param reg Value to store.
-    /// \param mode Addressing mode to use.
-    void ST(uint8_t reg, AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void ST(uint8_t reg);
 
     /// Increment memory.
-    /// \param mode Addressing mode to use.
-    void INC(AddressingMode mode);
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void INC();
 
     // Register
 
@@ -354,27 +572,33 @@ class CPU {
     /// Push P to stack.
     void PH(const StatusRegister &p);
 
+    /// Pull P from stack. B is left unchanged.
+    void PLP();
+
     /// Pull value from stack.
     /// \param reg_to Register to pull the value to.
     void PL(uint8_t &reg_to);
 
-    /// Pull value to status register.
-    /// \param p P register to pull the value to.
-    void PL(StatusRegister &p);
-
     // Unofficial "illegal" opcodes
 
-    // NOP with variable cycle count
-    void NOP_absx();
+    /// No operation.
+    void NOP();
+
+    /// No operation which fetches/skips an operand.
+    /// \tparam M Addressing mode to use.
+    template <AddressingMode M>
+    void NOP();
 
     // LDA + LDX == MEM -> A -> X
-    void LAX(AddressingMode mode);
+    template <AddressingMode M>
+    void LAX();
 
     // (A OR CONST) AND oper -> A -> X
     void LXA();
 
     // A AND X -> MEM
-    void SAX(AddressingMode mode);
+    template <AddressingMode M>
+    void SAX();
 
     // (A AND X - oper) -> X
     void SBX();
@@ -386,29 +610,35 @@ class CPU {
     // MEM - 1 -> MEM
     // A - MEM
     // Decrement operand and compare result to A
-    void DCP(AddressingMode mode);
+    template <AddressingMode M>
+    void DCP();
 
     // INC + SBC
     // MEM + 1 -> MEM
     // A - MEM - C -> A
-    void ISC(AddressingMode mode);
+    template <AddressingMode M>
+    void ISC();
 
     // ASL + ORA
     // M = C <- [76543210] <- 0, A OR MEM -> A
-    void SLO(AddressingMode mode);
+    template <AddressingMode M>
+    void SLO();
 
     // ROL + AND
     // M = C <- [76543210] <- 0, A AND MEM -> A
-    void RLA(AddressingMode mode);
+    template <AddressingMode M>
+    void RLA();
 
     // LSR + EOR
     // MEM = 0 -> [76543210] -> C, A EOR M -> A
-    void SRE(AddressingMode mode);
+    template <AddressingMode M>
+    void SRE();
 
     // ROR + ADC
     // M = C -> [76543210] -> C,
     // A + M + C -> A, C
-    void RRA(AddressingMode mode);
+    template <AddressingMode M>
+    void RRA();
 
     // AND oper + LSR
     void ALR();
@@ -424,7 +654,8 @@ class CPU {
     void ANE();
 
     // A AND X AND (H+1) -> M
-    void SHA(AddressingMode mode);
+    template <AddressingMode M>
+    void SHA();
 
     // A AND X -> SP, A AND X AND (H+1) -> M
     void TAS();
@@ -438,8 +669,8 @@ class CPU {
     // M AND SP -> A, X, SP
     void LAS();
 
-    // Halt execution
-    void JAM(uint8_t opcode);
+    // Halt execution, sets `jammed`
+    void JAM();
 };
 
 class InvalidOpcode {};
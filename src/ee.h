@@ -4,6 +4,7 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <bus.h>
@@ -15,6 +16,7 @@
 #define CALLGRIND_STOP_INSTRUMENTATION do {} while (0)
 #endif
 #include <cpu.h>
+#include <jit.h>
 #include <load.h>
 #include <logger.h>
 #include <mapper.h>
@@ -26,12 +28,12 @@
 // Scanline (341 pixels) is 113+(2/3) CPU clocks long
 // HBlank (85 pixels) is 28+(1/3) CPU clocks long
 // Frame is 29780.5 CPU clocks long
-// 3 PPU dots per 1 CPU cycle
+// 3 PPU dots per 1 CPU cycle, see NES::cpu_cycle_ticks and NES::ppu_dot_ticks
 // OAM DMA is 513 CPU cycles + 1 if starting on CPU get cycle
 // Cycle reference:
 // https://www.nesdev.org/wiki/Cycle_reference_chart
 //
-const int ntsc_cyc_ratio = 3;
+const int ntsc_cyc_ratio = NES::cpu_cycle_ticks / NES::ppu_dot_ticks;
 
 namespace NES {
 
@@ -51,6 +53,9 @@ class ExecutionEnvironment {
     std::atomic<bool> stop = false;
     std::atomic<bool> disable_ppu = false;
     std::atomic<bool> run_single_step = false;
+    std::atomic<bool> enable_jit = false;  ///< Use the JIT in `run_headless`
+
+    NES::JIT jit;
 
     std::function<void(ExecutionEnvironment &)> pre_step_hook;
     std::function<void(ExecutionEnvironment &)> post_step_hook;
@@ -64,7 +69,8 @@ class ExecutionEnvironment {
           bus(_bus),
           cpu(_cpu),
           ppu(_ppu),
-          logger(_logger) {
+          logger(_logger),
+          jit(_cpu) {
         gui.ppu = &ppu;
         gui.cpu = &cpu;
     }
@@ -78,19 +84,23 @@ class ExecutionEnvironment {
         // PPU /VBL line is connected directly to /NMI
         if (!disable_ppu)
             ppu.on_nmi_vblank = [&]() { cpu.schedule_nmi(); };
+        if (auto *nes_bus = dynamic_cast<NES::MemoryBus *>(bus))
+            nes_bus->sync_ppu = !disable_ppu;
 
         cpu.power();
         if (!disable_ppu)
             ppu.power();
 
         if (setup_hook) setup_hook(cpu, ppu);
+        // Hooks may move the CPU clock, both start out in step
+        ppu.synced = cpu.timestamp();
     }
 
     void load_iNESv1(std::string rom) {
         cartridge = NES::iNESv1::load(rom);
         mapper = NES::iNESv1::Mapper::mapper(cartridge.value());
-        bus->mapper = mapper;
-        ppu.mapper = mapper;
+        bus->set_mapper(mapper);
+        ppu.set_mapper(mapper);
         gui.mapper = mapper;
         gui.ppu = &ppu;
         gui.cpu = &cpu;
@@ -109,6 +119,7 @@ class ExecutionEnvironment {
     void run_headless(uint64_t frames) {
         ppu.headless = true;
         ppu.frame_count = 0;
+        ppu.render_frame = ppu.render_interval != 0;
         stop = false;
 
         CALLGRIND_START_INSTRUMENTATION;
@@ -116,16 +127,11 @@ class ExecutionEnvironment {
         while (!stop) {
             if (pre_step_hook) pre_step_hook(*this);
 
-            try {
-                uint16_t cpu_cycs = cpu.execute();
-                if (!disable_ppu)
-                    ppu.execute(ntsc_cyc_ratio * cpu_cycs);
-            } catch (NES::InvalidOpcode &e) {
-                std::cerr << "Unhandled opcode executed." << std::endl;
-                break;
-            } catch (NES::JAM &e) {
-                break;
-            }
+            uint32_t budget = cpu_budget();
+            NES::CPU::RunResult res =
+                enable_jit ? jit.execute(budget) : cpu.run(budget);
+            if (!disable_ppu) ppu.sync(cpu.timestamp());
+            if (res.status == NES::CPU::run_jam) break;
 
             if (post_step_hook) post_step_hook(*this);
 
@@ -138,30 +144,45 @@ class ExecutionEnvironment {
     }
 
 private:
+    /// Cycles the CPU runs at most between `stop` checks.
+    static const uint32_t max_batch_cycles = 0x8000;
+
+    /// Returns the cycles the CPU can run before the PPU raises the vblank
+    /// NMI or completes a frame. Both are observed between steps, so must
+    /// not happen in the middle of a batch. Anything else the PPU does is
+    /// only observed through the bus, which catches it up on demand, so
+    /// batches usually span the whole vblank or visible part of a frame.
+    /// Hooks and single stepping see every instruction.
+    uint32_t cpu_budget() {
+        if (pre_step_hook || post_step_hook || debug || run_single_step)
+            return 0;
+        if (disable_ppu) return max_batch_cycles;
+        uint32_t dots =
+            std::min(ppu.dots_until(1, 241), ppu.dots_until(320, 239));
+        // One less for a possible odd frame skip
+        return std::min(dots ? (dots - 1) / ntsc_cyc_ratio : 0,
+                        max_batch_cycles);
+    }
+
     void runloop() {
         using clock = std::chrono::steady_clock;
         constexpr auto target_frame_duration = std::chrono::microseconds(16667);
 
-        uint64_t last_frame = ppu.frame_count;
+        // Paced by rendered frames, the others run as fast as possible
+        uint64_t last_frame = ppu.render_count;
         auto next_frame_target = clock::now() + target_frame_duration;
 
         while (!stop) {
             if (pre_step_hook) pre_step_hook(*this);
 
-            try {
-                uint16_t cpu_cycs = cpu.execute();
-                if (!disable_ppu)
-                    ppu.execute(ntsc_cyc_ratio * cpu_cycs);
-            } catch (NES::InvalidOpcode &e) {
-                std::cerr << "Unhandled opcode executed." << std::endl;
-            } catch (NES::JAM &e) {
-                // TODO: Actually jam and handle reset
-            }
+            // TODO: Actually jam on run_jam and handle reset
+            cpu.run(cpu_budget());
+            if (!disable_ppu) ppu.sync(cpu.timestamp());
 
             if (post_step_hook) post_step_hook(*this);
 
-            if (ppu.frame_count != last_frame) {
-                last_frame = ppu.frame_count;
+            if (ppu.render_count != last_frame) {
+                last_frame = ppu.render_count;
                 auto now = clock::now();
                 if (now < next_frame_target)
                     std::this_thread::sleep_for(
@@ -149,8 +149,10 @@ void DebugWindow::draw_ppu_state() {
     if (ImGui::CollapsingHeader("Fetch State")) {
         ImGui::Text("Nametable byte: $%02X", ppu->nt);
         ImGui::Text("Attribute byte: $%02X", ppu->at);
-        ImGui::Text("BG shift low:   $%04X", ppu->bg_l_shift);
-        ImGui::Text("BG shift high:  $%04X", ppu->bg_h_shift);
+        ImGui::Text("BG shift low:   $%04X",
+                    NES::PPU::bitplane(ppu->bg_shift, 0));
+        ImGui::Text("BG shift high:  $%04X",
+                    NES::PPU::bitplane(ppu->bg_shift, 1));
     }
 
     ImGui::End();
@@ -197,34 +199,41 @@ void DebugWindow::draw_cpu_state() {
 
     // Status Register
     if (ImGui::CollapsingHeader("Status Register (P)", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::Text("Raw: $%02X", cpu->P.status);
+        NES::StatusRegister P = cpu->status();
+        ImGui::Text("Raw: $%02X", P.status);
         ImGui::Spacing();
         ImGui::Text("N V - B D I Z C");
         ImGui::Text("%c %c %c %c %c %c %c %c",
-                    cpu->P.N ? '1' : '0',
-                    cpu->P.V ? '1' : '0',
+                    P.N ? '1' : '0',
+                    P.V ? '1' : '0',
                     '-',
-                    (cpu->P.B & 0x2) ? '1' : '0',
-                    cpu->P.D ? '1' : '0',
-                    cpu->P.I ? '1' : '0',
-                    cpu->P.Z ? '1' : '0',
-                    cpu->P.C ? '1' : '0');
+                    (P.B & 0x2) ? '1' : '0',
+                    P.D ? '1' : '0',
+                    P.I ? '1' : '0',
+                    P.Z ? '1' : '0',
+                    P.C ? '1' : '0');
         ImGui::Spacing();
-        ImGui::Text("N (Negative):  %s", cpu->P.N ? "Set" : "Clear");
-        ImGui::Text("V (Overflow):  %s", cpu->P.V ? "Set" : "Clear");
-        ImGui::Text("B (Break):     %u", cpu->P.B);
-        ImGui::Text("D (Decimal):   %s", cpu->P.D ? "Set" : "Clear");
-        ImGui::Text("I (IRQ Dis.):  %s", cpu->P.I ? "Set" : "Clear");
-        ImGui::Text("Z (Zero):      %s", cpu->P.Z ? "Set" : "Clear");
-        ImGui::Text("C (Carry):     %s", cpu->P.C ? "Set" : "Clear");
+        ImGui::Text("N (Negative):  %s", P.N ? "Set" : "Clear");
+        ImGui::Text("V (Overflow):  %s", P.V ? "Set" : "Clear");
+        ImGui::Text("B (Break):     %u", P.B);
+        ImGui::Text("D (Decimal):   %s", P.D ? "Set" : "Clear");
+        ImGui::Text("I (IRQ Dis.):  %s", P.I ? "Set" : "Clear");
+        ImGui::Text("Z (Zero):      %s", P.Z ? "Set" : "Clear");
+        ImGui::Text("C (Carry):     %s", P.C ? "Set" : "Clear");
     }
 
     ImGui::Separator();
 
     // Interrupt State
     if (ImGui::CollapsingHeader("Interrupts", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui::Text("IRQ line: %s", cpu->IRQ ? "Asserted" : "Clear");
-        ImGui::Text("NMI line: %s", cpu->NMI ? "Asserted" : "Clear");
+        ImGui::Text("IRQ line: %s",
+                    cpu->scheduler.scheduled(NES::Scheduler::ev_irq)
+                        ? "Asserted"
+                        : "Clear");
+        ImGui::Text("NMI line: %s",
+                    cpu->scheduler.scheduled(NES::Scheduler::ev_nmi)
+                        ? "Asserted"
+                        : "Clear");
     }
 
     ImGui::Separator();
@@ -232,7 +241,8 @@ void DebugWindow::draw_cpu_state() {
     // Execution State
     if (ImGui::CollapsingHeader("Execution", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Text("Current opcode: $%02X", cpu->opcode);
-        ImGui::Text("Cycle count:    %u", cpu->cycles);
+        ImGui::Text("Cycle count:    %llu",
+                    (unsigned long long)cpu->cycles);
     }
 
     ImGui::End();
@@ -253,12 +263,14 @@ void DebugWindow::render_chr_table(std::vector<uint32_t> &fb,
             break;
 
         for (int y = 0; y < 8; y++) {
-            uint8_t p0 = mapper->cartridge.chr_rom[tile_start + y];
-            uint8_t p1 = mapper->cartridge.chr_rom[tile_start + y + 8];
+            // Decoded here, the PPU's tile cache belongs to the emulation
+            // thread
+            const auto &chr_rom = mapper->cartridge.chr_rom;
+            uint16_t row = NES::PPU::decode_row(chr_rom[tile_start + y],
+                                                chr_rom[tile_start + y + 8],
+                                                false);
             for (int x = 0; x < 8; x++) {
-                bool b0 = (p0 >> (7 - x)) & 1;
-                bool b1 = (p1 >> (7 - x)) & 1;
-                uint8_t c_idx = (b1 << 1) | b0;
+                uint8_t c_idx = (row >> ((7 - x) * 2)) & 0x3;
 
                 uint32_t c;
                 switch (c_idx) {
@@ -9,6 +9,7 @@
 #include <imgui_impl_sdlrenderer2.h>
 #include <log.h>
 #include <mapper.h>
+#include <pixel.h>
 
 #include <atomic>
 #include <format>
@@ -69,9 +70,22 @@ public:
         if (wnd)   SDL_DestroyWindow(wnd);
     }
 
-    void draw_frame(uint32_t *fb) {
-        if (fb)
-            SDL_UpdateTexture(tex, NULL, fb, fb_x * sizeof(uint32_t));
+    /// Presents a frame.
+    /// \param fb Pixels, `rgba` indices, or nullptr to present the last one
+    /// \param rgba RGBA of the pixels
+    void draw_frame(const uint16_t *fb, const uint32_t *rgba) {
+        void *pixels;
+        int pitch;
+        // Converted straight into the texture
+        if (fb && SDL_LockTexture(tex, NULL, &pixels, &pitch) == 0) {
+            for (int y = 0; y < fb_y; y++) {
+                NES::Pixel::to_rgba(
+                    fb + y * fb_x, fb_x, rgba,
+                    reinterpret_cast<uint32_t *>(
+                        static_cast<uint8_t *>(pixels) + y * pitch));
+            }
+            SDL_UnlockTexture(tex);
+        }
         SDL_Rect dest = { 0, 0, fb_x*2, fb_y*2 };
         SDL_RenderClear(ren);
         SDL_RenderCopy(ren, tex, NULL, &dest);
@@ -169,7 +183,8 @@ class GUI {
     NES::Controller *controller1 = nullptr;
 
     std::atomic<bool> main_fb_ready = false;
-    uint32_t *main_fb = nullptr;
+    uint16_t *main_fb = nullptr;
+    const uint32_t *main_rgba = nullptr;
 
     const int fb_x, fb_y;
     const std::string main_font_name = "Inter-VariableFont.ttf";
@@ -208,7 +223,7 @@ class GUI {
     }
 
     void enter_runloop() {
-        main->draw_frame(nullptr);
+        main->draw_frame(nullptr, nullptr);
 
         // Pass PPU and CPU references to the debug window
         if (debug) {
@@ -220,7 +235,7 @@ class GUI {
             if (handle_events()) break;
 
             if (main_fb_ready) {
-                main->draw_frame(main_fb);
+                main->draw_frame(main_fb, main_rgba);
                 main_fb_ready = false;
             }
 
@@ -229,8 +244,9 @@ class GUI {
         }
     }
 
-    void draw_frame(uint32_t *fb) {
+    void draw_frame(uint16_t *fb, const uint32_t *rgba) {
         main_fb = fb;
+        main_rgba = rgba;
         main_fb_ready = true;
     }
 
@@ -0,0 +1,204 @@
+#include <bus.h>
+#include <jit.h>
+#include <log.h>
+#include <opcodes.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define NES_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+using namespace NES;
+
+// Generated code for a block:
+//
+//     push rbx
+//     mov rbx, rdi              ; CPUCore *
+//     ; for every instruction:
+//     mov rdi, rbx
+//     mov rsi, <DecodedOp *>
+//     mov edx, <PC>
+//     mov rax, <CPUCore::jit_op<opcode>>
+//     call rax
+//     ; end
+//     pop rbx
+//     ret
+//
+// The handlers do all the work, so translated code behaves exactly like
+// `CPU::execute` minus the fetch, dispatch and interrupt checks.
+
+static const size_t prologue_len = 4;
+static const size_t call_len = 30;
+static const size_t epilogue_len = 2;
+
+JIT::JIT(NES::CPU &cpu) : cpu(cpu), core(dynamic_cast<Core *>(&cpu)) {}
+
+JIT::~JIT() {
+#ifdef NES_JIT_X86_64
+    if (code) munmap(code, code_sz);
+#endif
+}
+
+bool JIT::supported() {
+#ifdef NES_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+CPU::RunResult JIT::execute(uint32_t budget) {
+    // Interrupts and DMA are left to the interpreter
+    if (!supported() || !core || cpu.scheduler.next() != Scheduler::never)
+        return cpu.run(0);
+    if (unavailable) return cpu.run(budget);
+    if (core->bus->mapper != core->prg_mapper) core->attach_prg_cache();
+    if (core->prg_mapper != mapper) flush();
+
+    // Translated blocks don't touch I/O, the instructions in between which
+    // may are interpreted and the bus catches devices up, so both can run
+    // back to back for as long as the budget allows
+    uint64_t initial_cyc = core->cycles;
+    uint32_t elapsed = 0;
+    while (core->PC >= 0x8000 && !unavailable) {
+        int32_t window =
+            core->prg_window[(core->PC - 0x8000) / Core::prg_window_sz];
+        if (window < 0) break;
+        uint32_t offset = window + core->PC % Core::prg_window_sz;
+        uint16_t id = block_ids[offset];
+        while (id && blocks[id - 1].pc != core->PC) id = blocks[id - 1].next;
+        const Block *block = id ? &blocks[id - 1] : nullptr;
+        // Only code entered often enough is worth translating
+        if (!block && entries[offset] < hot_entries) entries[offset]++;
+        if (!block && entries[offset] == hot_entries)
+            block = &translate(offset, core->PC);
+        if (!block || !block->code) {
+            if (elapsed > budget) break;
+            CPU::RunResult res = cpu.run(0);
+            elapsed = core->cycles - initial_cyc;
+            if (res.status == CPU::run_jam) return {elapsed, CPU::run_jam};
+            // Interrupts the instruction raised are left to the interpreter
+            if (cpu.scheduler.next() != Scheduler::never) break;
+            continue;
+        }
+        if (elapsed + block->max_cycles > budget) break;
+
+        reinterpret_cast<void (*)(Core *)>(block->code)(core);
+        elapsed = core->cycles - initial_cyc;
+    }
+    return elapsed ? CPU::RunResult{elapsed, CPU::run_ok} : cpu.run(0);
+}
+
+void JIT::flush() {
+    mapper = core->prg_mapper;
+    block_ids.assign(core->prg_cache.size(), 0);
+    entries.assign(core->prg_cache.size(), 0);
+    blocks.clear();
+    code_len = 0;
+}
+
+bool JIT::translatable(const Core::DecodedOp &op) {
+    // JAM halts the CPU, which is left to the interpreter
+    return op.memory_only && strcmp(op_info[op.opcode].mnemonic, "JAM");
+}
+
+const JIT::Block &JIT::translate(uint32_t offset, uint16_t pc) {
+    static const Block none = {nullptr, 0x0, 0, 0};
+
+#ifdef NES_JIT_X86_64
+    if (unavailable) return none;
+    // Code memory is never writable and executable at the same time, it's
+    // only made writable while a block is emitted
+    if (!code) {
+        void *mem = mmap(nullptr, code_sz, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (mem == MAP_FAILED) {
+            NES_LOG("JIT") << "Unable to map code memory" << std::endl;
+            unavailable = true;
+            return none;
+        }
+        code = static_cast<uint8_t *>(mem);
+    } else if (mprotect(code, code_sz, PROT_READ | PROT_WRITE)) {
+        NES_LOG("JIT") << "Unable to make code memory writable" << std::endl;
+        unavailable = true;
+        return none;
+    }
+    // Out of memory for blocks, start over
+    if (blocks.size() == max_blocks ||
+        code_len + prologue_len + max_block_len * call_len + epilogue_len >
+            code_sz)
+        flush();
+
+    Block block = {code + code_len, pc, 0, 0};
+    emit(
+        "\x53"           // push rbx
+        "\x48\x89\xFB",  // mov rbx, rdi
+        prologue_len);
+
+    uint32_t cycles = 0;
+    size_t n = 0;
+    uint16_t addr = pc;
+    while (n < max_block_len) {
+        // Blocks don't span cache windows, which are switched independently
+        if ((addr ^ pc) & ~(Core::prg_window_sz - 1)) break;
+        const Core::DecodedOp *op = core->decoded(addr);
+        if (!op || !translatable(*op)) break;
+
+        const OpInfo &info = op_info[op->opcode];
+        block.max_cycles = cycles;
+        cycles += info.cycles + info.page_penalty;
+
+        emit("\x48\x89\xDF", 3);  // mov rdi, rbx
+        emit("\x48\xBE", 2);      // mov rsi, imm64
+        emit64((uint64_t)op);
+        emit8(0xBA);  // mov edx, imm32
+        emit32(addr);
+        emit("\x48\xB8", 2);  // mov rax, imm64
+        emit64((uint64_t)Core::jit_handlers[op->opcode]);
+        emit("\xFF\xD0", 2);  // call rax
+        n++;
+
+        if (op_transfers_control(op->opcode)) break;
+        addr += info.len;
+    }
+
+    if (n) {
+        emit(
+            "\x5B"   // pop rbx
+            "\xC3",  // ret
+            epilogue_len);
+    } else {
+        code_len = block.code - code;
+        block.code = nullptr;
+    }
+    if (mprotect(code, code_sz, PROT_READ | PROT_EXEC)) {
+        // None of the blocks can run anymore
+        NES_LOG("JIT") << "Unable to make code memory executable" << std::endl;
+        flush();
+        unavailable = true;
+        return none;
+    }
+    // Blocks for the same offset at other addresses stay valid
+    block.next = block_ids[offset];
+    blocks.push_back(block);
+    block_ids[offset] = blocks.size();
+    return blocks.back();
+#else
+    return none;
+#endif
+}
+
+void JIT::emit(const void *data, size_t len) {
+    std::memcpy(code + code_len, data, len);
+    code_len += len;
+}
+
+void JIT::emit8(uint8_t value) { emit(&value, sizeof(value)); }
+
+void JIT::emit32(uint32_t value) { emit(&value, sizeof(value)); }
+
+void JIT::emit64(uint64_t value) { emit(&value, sizeof(value)); }
@@ -0,0 +1,102 @@
+#ifndef INC_2A03_JIT_H
+#define INC_2A03_JIT_H
+
+#include <cpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NES {
+
+/// Dynamic recompiler for PRG ROM code. Translates straight-line runs of
+/// instructions into x86-64 code which calls the CPU opcode handlers
+/// directly, skipping the per-instruction fetch, dispatch and interrupt
+/// checks of `CPU::run`. Code is interpreted until it's hot, entered
+/// `hot_entries` times.
+///
+/// Only instructions whose bus accesses provably stay in internal RAM,
+/// PRG RAM or PRG ROM are translated. I/O accesses, indirect addressing,
+/// unstable and JAM opcodes, and any code running from RAM go through
+/// `CPU::run`, so the PPU never observes the CPU in the middle of a
+/// block and cycle counts stay exact at block boundaries.
+class JIT {
+   public:
+    /// Initializes a JIT for the provided CPU. Code memory is allocated on
+    /// first use. CPUs on other buses than `NES::MemoryBus` always run
+    /// through `CPU::run`.
+    explicit JIT(NES::CPU &cpu);
+
+    ~JIT();
+
+    JIT(const JIT &) = delete;
+    JIT &operator=(const JIT &) = delete;
+
+    /// Returns `true` if native code generation is supported on this host.
+    static bool supported();
+
+    /// Executes translated blocks starting at PC, or a single instruction
+    /// through `CPU::run` if there are none.
+    /// \param budget Cycles which can elapse before the last instruction
+    /// starts, e.g. until the PPU raises an NMI. Blocks which can take
+    /// longer aren't run.
+    /// \return Cycles executed and the reason execution stopped.
+    CPU::RunResult execute(uint32_t budget);
+
+    /// Drops all translated blocks.
+    void flush();
+
+   protected:
+    /// Translated block.
+    struct Block {
+        uint8_t *code;        ///< Native code, nullptr if untranslatable.
+        uint16_t pc;          ///< Address the block was translated for.
+        uint16_t max_cycles;  ///< Upper bound of cycles taken by all
+                              ///< instructions but the last.
+        uint16_t next;        ///< Index + 1 of the block translated for
+                              ///< the same offset at another address, 0
+                              ///< if none.
+    };
+
+    static const size_t code_sz = 0x100000;  ///< Code memory size - 1MB.
+    static const size_t max_block_len = 32;  ///< Instructions per block.
+    static const size_t max_blocks = 0xFFFF; ///< Blocks until a flush.
+    /// Times execution has to enter an address before it's translated.
+    static const uint8_t hot_entries = 16;
+
+    using Core = CPUCore<MemoryBus>;
+
+    NES::CPU &cpu;
+    Core *core;  ///< `cpu` if it runs on `NES::MemoryBus`, nullptr otherwise.
+    /// Index + 1 into `blocks` by PRG ROM offset, 0 if not translated.
+    /// Mirrored ROM is entered at several addresses, see `Block::next`.
+    std::vector<uint16_t> block_ids;
+    /// Times execution entered `execute`'s loop at every PRG ROM offset
+    /// without a block, up to `hot_entries`.
+    std::vector<uint8_t> entries;
+    std::vector<Block> blocks;  ///< Translated blocks.
+    uint8_t *code = nullptr;    ///< Code memory.
+    size_t code_len = 0;        ///< Used code memory.
+    iNESv1::Mapper::Base *mapper = nullptr;  ///< Mapper blocks belong to.
+    /// Code memory couldn't be mapped or protected, everything runs through
+    /// `CPU::run` from then on.
+    bool unavailable = false;
+
+    /// Translates the block starting at pc.
+    /// \param offset PRG ROM offset of the first instruction.
+    /// \param pc Address of the first instruction.
+    /// \return Translated block.
+    const Block &translate(uint32_t offset, uint16_t pc);
+
+    /// Returns `true` if the instruction can be part of a block.
+    static bool translatable(const Core::DecodedOp &op);
+
+    void emit(const void *data, size_t len);
+    void emit8(uint8_t value);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+};
+
+}  // namespace NES
+
+#endif  // INC_2A03_JIT_H
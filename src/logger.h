@@ -56,13 +56,6 @@ class SystemLogGenerator {
                                         ///< on each `log_ppu` call.
 
    private:
-    /// Decodes an opcode into a readable string form.
-    static std::string decode(uint8_t opcode);
-
-    /// Returns the addressing mode for an opcode, if it's
-    /// applicable.
-    static std::optional<NES::AddressingMode> addr_mode_for_op(uint8_t opcode);
-
     /// Returns a templated string for provided mode.
     /// \param addr_mode Addressing mode to provide a template for.
     /// \return Templated string for provided mode with optional
@@ -71,19 +64,12 @@ class SystemLogGenerator {
     static std::string templ_for_mode(NES::AddressingMode addr_mode,
                                       uint8_t opcode);
 
-    /// Returns the operand length in bytes for provided mode.
-    static uint8_t operand_len(NES::AddressingMode addr_mode);
-
     /// If there is a target for a specified mode, returns
     /// the amount of bytes to be printed.
     static uint8_t target_len(NES::AddressingMode addr_mode, uint8_t opcode);
 
     /// Retrieve target value for specified addressing mode.
     uint16_t target_value(NES::AddressingMode addr_mode);
-
-    /// Returns true if provided `opcode` is part of the official
-    /// instruction set.
-    static bool is_opcode_legal(uint8_t opcode);
 };
 }  // namespace NES
 
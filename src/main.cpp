@@ -37,14 +37,20 @@ struct Options {
     bool run_nestest_i = false;
     bool run_ppu_tests = false;
     bool run_cpu_tests = false;
+    bool run_pixel_bench = false;
+    bool run_fast_path_checks = false;
     uint64_t headless_frames = 0;  // Headless profiling mode (0 = disabled)
+    bool jit = false;              // Use the JIT headless and in CPU tests
+    uint32_t render_interval = 1;  // Render every Nth frame (0 = none)
+    std::string profile;           // Guest profile output file
+    std::string stats;             // Execution statistics JSON output file
     std::string rom;
     std::string logfile;
 
     Options(int argc, char *argv[]) {
         int opt;
 
-        while ((opt = getopt(argc, argv, "cepbmsdtiuyr:l:h:")) != -1) {
+        while ((opt = getopt(argc, argv, "cepbmsdtiuyjkxr:l:h:g:S:f:")) != -1) {
             switch (opt) {
             case 'c': log_cpu = true; break;
             case 'e': log_ppu = true; break;
@@ -57,14 +63,21 @@ struct Options {
             case 'i': run_nestest_i = true; break;
             case 'u': run_cpu_tests = true; break;
             case 'y': run_ppu_tests = true; break;
+            case 'k': run_pixel_bench = true; break;
+            case 'x': run_fast_path_checks = true; break;
             case 'r': rom = optarg; break;
             case 'l': logfile = optarg; break;
             case 'h': headless_frames = std::stoull(optarg); break;
+            case 'j': jit = true; break;
+            case 'g': profile = optarg; break;
+            case 'S': stats = optarg; break;
+            case 'f': render_interval = std::stoul(optarg); break;
             case '?':
             default:
                 std::cerr << "Usage: " << argv[0]
-                          << " [-cepbmsdtiuy] [-r filename.nes] [-l logfile] "
-                             "[-h frames]"
+                          << " [-cepbmsdtiuyjkx] [-r filename.nes] "
+                             "[-l logfile] [-h frames] [-g profile] "
+                             "[-S stats.json] [-f N]"
                           << std::endl;
                 std::cerr << "Where:" << std::endl;
                 std::cerr << "-c - Enable CPU debug logging" << std::endl;
@@ -83,11 +96,30 @@ struct Options {
                           << std::endl;
                 std::cerr << "-u - Run CPU tests" << std::endl;
                 std::cerr << "-y - Run PPU tests" << std::endl;
+                std::cerr << "-k - Check and benchmark the pixel composition "
+                             "kernels"
+                          << std::endl;
+                std::cerr << "-x - Check the PPU fast paths and batched CPU "
+                             "runs against running dot by dot and "
+                             "instruction by instruction, and the palette "
+                             "emphasis"
+                          << std::endl;
                 std::cerr << "-r - Load a ROM from filename" << std::endl;
                 std::cerr << "-l - Log to file" << std::endl;
                 std::cerr << "-h - Headless profiling mode (run N frames "
                              "without GUI)"
                           << std::endl;
+                std::cerr << "-j - Use the JIT in headless mode, run the CPU "
+                             "tests through its entries"
+                          << std::endl;
+                std::cerr << "-g - Write a guest code profile to <file> in "
+                             "Callgrind format, and as CSV to <file>.csv"
+                          << std::endl;
+                std::cerr << "-S - Write execution statistics as JSON"
+                          << std::endl;
+                std::cerr << "-f - Render every Nth frame only, 0 for none, "
+                             "the others run unthrottled"
+                          << std::endl;
                 throw std::runtime_error("Invalid usage");
             }
         }
@@ -126,21 +158,25 @@ int main(int argc, char *argv[]) {
     NES::Controller controller1, controller2;
     NES::MemoryBusIntf *bus;
     NES::Test::MemoryBus *mock_bus = nullptr;
+    NES::CPU *cpu_core;
     if (opts.run_cpu_tests) {
         mock_bus = new NES::Test::MemoryBus();
         bus = mock_bus;
+        cpu_core = new NES::CPUCore<NES::Test::MemoryBus>(mock_bus);
     } else {
-        bus = new NES::MemoryBus(ppu, apu, controller1, controller2);
-    }
-    NES::CPU cpu(bus);
-    if (!mock_bus) {
-        ((NES::MemoryBus*)bus)->cpu = &cpu;
+        auto *nes_bus = new NES::MemoryBus(ppu, apu, controller1, controller2);
+        bus = nes_bus;
+        cpu_core = new NES::CPUCore<NES::MemoryBus>(nes_bus);
+        nes_bus->cpu = cpu_core;
         gui.controller1 = &controller1;
     }
+    NES::CPU &cpu = *cpu_core;
     NES::SystemLogGenerator logger(cpu, ppu, bus);
     NES::ExecutionEnvironment ee(gui, bus, cpu, ppu, logger);
 
     ee.debug = opts.step_debug;
+    ee.enable_jit = opts.jit;
+    ppu.render_interval = opts.render_interval;
 
     // SystemLogGenerator state logging (for nestest)
     if (opts.log_cpu_state) logger.instr_ostream = std::cerr;
@@ -154,23 +190,53 @@ int main(int argc, char *argv[]) {
         std::cout << "Running " << opts.rom << std::endl;
         ee.load_iNESv1(opts.rom);
         ee.power(nullptr);
-        ee.pre_step_hook = [&](auto &ee) {
-            if (opts.log_cpu) {
+        // The hook makes the CPU run one instruction at a time
+        if (opts.log_cpu) {
+            ee.pre_step_hook = [&](auto &ee) {
                 std::string log = ee.logger.log();
                 NES_LOG("CPU") << log << std::endl;
-            }
-        };
+            };
+        }
         if (opts.headless_frames > 0) {
             ee.run_headless(opts.headless_frames);
+#ifdef NES_ENABLE_PROFILER
+            cpu.profiler.print_stats(std::cout);
+#endif
         } else {
             ee.run();
         }
+        if (!opts.profile.empty() || !opts.stats.empty()) {
+#ifdef NES_ENABLE_PROFILER
+            if (!opts.profile.empty()) {
+                std::ofstream cg(opts.profile);
+                cpu.profiler.write_callgrind(cg, opts.rom);
+                std::ofstream csv(opts.profile + ".csv");
+                cpu.profiler.write_csv(csv);
+            }
+            if (!opts.stats.empty()) {
+                std::ofstream json(opts.stats);
+                cpu.profiler.write_stats_json(json);
+            }
+#else
+            std::cerr << "Profiler not compiled in, see ENABLE_PROFILER"
+                      << std::endl;
+#endif
+        }
     } else if (opts.run_nestest) {
         NES::Test::nestest(ee, opts.run_nestest_i);
     } else if (opts.run_ppu_tests) {
         NES::Test::ppu(ee);
     } else if (opts.run_cpu_tests) {
-        NES::Test::cpu(ee, mock_bus);
+        NES::Test::cpu(ee, mock_bus, opts.jit);
+    } else if (opts.run_pixel_bench) {
+        NES::Test::pixel_kernels(pal);
+    } else if (opts.run_fast_path_checks) {
+        bool same = true;
+        for (unsigned seed = 1; seed <= 8; seed++)
+            same &= NES::Test::ppu_fast_paths(gui, pal, seed, 30);
+        same &= NES::Test::ppu_sync(ee, 300);
+        same &= NES::Test::palette_emphasis(pal);
+        if (!same) return 1;
     }
 
     // if (bus)
@@ -74,6 +74,22 @@ uint8_t Mapper::NROM::read_prg(uint16_t addr) {
     }
 }
 
+int32_t Mapper::NROM::prg_rom_offset(uint16_t addr) {
+    if (addr < 0x8000) return -1;
+    // High 16KB PRG ROM is mirrored low if 16KB
+    uint16_t base = cartridge.header.prg_rom_banks == 1 && addr >= 0xC000
+                        ? 0xC000
+                        : 0x8000;
+    if ((size_t)(addr - base) >= cartridge.prg_rom.size()) return -1;
+    return addr - base;
+}
+
+int32_t Mapper::NROM::prg_ram_offset(uint16_t addr) {
+    if (addr < 0x6000 || addr >= 0x8000) return -1;
+    if ((size_t)(addr - 0x6000) >= cartridge.prg_ram.size()) return -1;
+    return addr - 0x6000;
+}
+
 void Mapper::NROM::write_prg(uint16_t addr, uint8_t val) {
     switch (addr) {
     case 0x4020 ... 0x5FFF:
@@ -125,6 +141,12 @@ void Mapper::NROM::write_ppu(uint16_t addr, uint8_t val) {
               << std::endl;
 }
 
+const uint8_t *Mapper::NROM::chr_page(uint16_t addr) {
+    size_t page = addr & 0x1C00;
+    if (page + 0x400 > cartridge.chr_rom.size()) return nullptr;
+    return &cartridge.chr_rom[page];
+}
+
 // MMC1
 
 Mapper::MMC1::MMC1(Cartridge &cartridge)
@@ -160,6 +182,26 @@ uint8_t Mapper::MMC1::read_prg(uint16_t addr) {
     }
 }
 
+int32_t Mapper::MMC1::prg_rom_offset(uint16_t addr) {
+    if (addr < 0x8000) return -1;
+    if (prg_bank_sz == size_32k)
+        return (prg_bank >> 1) * prg_rom_page_sz + (addr - 0x8000);
+    bool swappable = is_low_bank(addr) == (prg_bank_swap == swap_l_prg_bank);
+    uint32_t bank;
+    if (swappable)
+        bank = prg_bank;
+    else
+        bank = is_low_bank(addr) ? 0 : cartridge.header.prg_rom_banks - 1;
+    return bank * prg_rom_page_sz + (addr & 0x3FFF);
+}
+
+int32_t Mapper::MMC1::prg_ram_offset(uint16_t addr) {
+    // TODO: PRG RAM bankswitching?
+    if (addr < 0x6000 || addr >= 0x8000) return -1;
+    if ((size_t)(addr - 0x6000) >= cartridge.prg_ram.size()) return -1;
+    return addr - 0x6000;
+}
+
 void Mapper::MMC1::write_prg(uint16_t addr, uint8_t val) {
     switch (addr) {
     case 0x6000 ... 0x7FFF: cartridge.prg_ram[addr - 0x6000] = val; break;
@@ -244,11 +286,14 @@ void Mapper::MMC1::set_main_ctrl_reg(uint8_t value) {
     prg_bank_swap = PRGBankSwap((value >> 2) & 0b1);
     prg_bank_sz = PRGBankSize((value >> 3) & 0b1);
     chr_bank_sz = CHRBankSize((value >> 4) & 0b1);
+    prg_bank_switched();
+    chr_bank_switched(0x0000, 0x2000);
 }
 
 void Mapper::MMC1::set_prg_bank_reg(uint8_t value) {
     prg_bank = (uint8_t)(value & 0b1111);
     wram_enable = (bool)((value & 0b10000) >> 4);
+    prg_bank_switched();
 }
 
 uint8_t Mapper::MMC1::read_32k_prg_bank(uint16_t addr) const {
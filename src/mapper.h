@@ -3,6 +3,10 @@
 
 #include <ines.h>
 
+#include <cstdint>
+#include <functional>
+#include <vector>
+
 namespace NES {
 namespace iNESv1 {
 namespace Mapper {
@@ -42,6 +46,41 @@ class Base {
 
     /// Writes a byte from PPU bus at the provided address.
     virtual void write_ppu(uint16_t addr, uint8_t val) = 0;
+
+    /// Returns the CHR memory mapped at a 1k PPU page.
+    /// \param addr Address of the page, $0000-$1FFF
+    /// \return Memory of the page or nullptr if reads have to go through
+    /// `read_ppu`.
+    virtual const uint8_t *chr_page(uint16_t addr) { return nullptr; }
+
+    /// Returns the PRG ROM offset mapped at the provided CPU address.
+    /// \return Offset into `cartridge.prg_rom` or -1 if the address isn't
+    /// mapped to PRG ROM.
+    virtual int32_t prg_rom_offset(uint16_t addr) = 0;
+
+    /// Returns the PRG RAM offset mapped at the provided CPU address.
+    /// \return Offset into `cartridge.prg_ram` or -1 if the address isn't
+    /// mapped to PRG RAM.
+    virtual int32_t prg_ram_offset(uint16_t addr) = 0;
+
+    /// Listeners called after the PRG bank mapping changes.
+    std::vector<std::function<void()>> on_prg_bank_switch;
+
+    /// Listeners called after the CHR bank mapping or the nametable
+    /// mirroring changes, with the first PPU address and the size of the
+    /// range switched.
+    std::vector<std::function<void(uint16_t, uint16_t)>> on_chr_bank_switch;
+
+   protected:
+    /// Notifies every `on_prg_bank_switch` listener.
+    void prg_bank_switched() {
+        for (auto &listener : on_prg_bank_switch) listener();
+    }
+
+    /// Notifies every `on_chr_bank_switch` listener.
+    void chr_bank_switched(uint16_t addr, uint16_t size) {
+        for (auto &listener : on_chr_bank_switch) listener(addr, size);
+    }
 };
 
 class NROM : public Mapper::Base {
@@ -60,6 +99,12 @@ class NROM : public Mapper::Base {
     uint8_t read_ppu(uint16_t addr) final;
 
     void write_ppu(uint16_t addr, uint8_t val) final;
+
+    const uint8_t *chr_page(uint16_t addr) final;
+
+    int32_t prg_rom_offset(uint16_t addr) final;
+
+    int32_t prg_ram_offset(uint16_t addr) final;
 };
 
 class MMC1 : public Mapper::Base {
@@ -89,6 +134,10 @@ class MMC1 : public Mapper::Base {
 
     void write_ppu(uint16_t addr, uint8_t val) final;
 
+    int32_t prg_rom_offset(uint16_t addr) final;
+
+    int32_t prg_ram_offset(uint16_t addr) final;
+
    private:
     // Shift register contents
     uint8_t shift_reg;    ///< Shift register (SR).
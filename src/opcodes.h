@@ -0,0 +1,399 @@
+#ifndef INC_2A03_OPCODES_H
+#define INC_2A03_OPCODES_H
+
+#include <cpu.h>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace NES {
+
+/// Static information about an opcode.
+struct OpInfo {
+    const char *mnemonic;  ///< Mnemonic, unofficial opcodes use nestest names.
+    AddressingMode mode;   ///< Addressing mode.
+    uint8_t len;           ///< Instruction length in bytes, including opcode.
+    uint8_t cycles;        ///< Base cycle count. Doesn't include branch,
+                           ///< page crossing or interrupt cycles.
+    bool page_penalty;     ///< Crossing a page boundary on indexed operand
+                           ///< fetch adds a cycle.
+    bool legal;            ///< Is part of the official instruction set.
+    bool unstable;         ///< Unofficial opcode with unstable behaviour, not
+                           ///< covered by the nes6502 tests.
+};
+
+/// Flags for `make_op`.
+enum OpFlags : uint8_t {
+    op_page_penalty = 1 << 0,
+    op_unofficial = 1 << 1,
+    op_unstable = 1 << 2,
+};
+
+/// Returns the instruction length in bytes for an addressing mode.
+constexpr uint8_t op_len(AddressingMode mode) {
+    switch (mode) {
+    case impl:
+    case acc: return 1;
+    case abs:
+    case abs_x:
+    case abs_y:
+    case ind: return 3;
+    default: return 2;
+    }
+}
+
+/// Builds an `OpInfo`, deriving the length from the addressing mode.
+/// \param flags `OpFlags` combination.
+constexpr OpInfo make_op(const char *mnemonic, AddressingMode mode,
+                         uint8_t cycles, int flags = 0) {
+    return {mnemonic,
+            mode,
+            op_len(mode),
+            cycles,
+            bool(flags & op_page_penalty),
+            !(flags & op_unofficial),
+            bool(flags & op_unstable)};
+}
+
+/// Opcode information table, indexed by opcode. Used by the CPU for cycle
+/// counting, by the logger for disassembly and by the tests.
+inline constexpr std::array<OpInfo, 256> op_info = {
+    /* 00 */ make_op("BRK", impl, 7),
+    /* 01 */ make_op("ORA", idx_ind_x, 6),
+    /* 02 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 03 */ make_op("SLO", idx_ind_x, 8, op_unofficial),
+    /* 04 */ make_op("NOP", zp, 3, op_unofficial),
+    /* 05 */ make_op("ORA", zp, 3),
+    /* 06 */ make_op("ASL", zp, 5),
+    /* 07 */ make_op("SLO", zp, 5, op_unofficial),
+    /* 08 */ make_op("PHP", impl, 3),
+    /* 09 */ make_op("ORA", imm, 2),
+    /* 0A */ make_op("ASL", acc, 2),
+    /* 0B */ make_op("ANC", imm, 2, op_unofficial),
+    /* 0C */ make_op("NOP", abs, 4, op_unofficial),
+    /* 0D */ make_op("ORA", abs, 4),
+    /* 0E */ make_op("ASL", abs, 6),
+    /* 0F */ make_op("SLO", abs, 6, op_unofficial),
+    /* 10 */ make_op("BPL", rel, 2),
+    /* 11 */ make_op("ORA", ind_idx_y, 5, op_page_penalty),
+    /* 12 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 13 */ make_op("SLO", ind_idx_y, 8, op_unofficial),
+    /* 14 */ make_op("NOP", zp_x, 4, op_unofficial),
+    /* 15 */ make_op("ORA", zp_x, 4),
+    /* 16 */ make_op("ASL", zp_x, 6),
+    /* 17 */ make_op("SLO", zp_x, 6, op_unofficial),
+    /* 18 */ make_op("CLC", impl, 2),
+    /* 19 */ make_op("ORA", abs_y, 4, op_page_penalty),
+    /* 1A */ make_op("NOP", impl, 2, op_unofficial),
+    /* 1B */ make_op("SLO", abs_y, 7, op_unofficial),
+    /* 1C */ make_op("NOP", abs_x, 4, op_page_penalty | op_unofficial),
+    /* 1D */ make_op("ORA", abs_x, 4, op_page_penalty),
+    /* 1E */ make_op("ASL", abs_x, 7),
+    /* 1F */ make_op("SLO", abs_x, 7, op_unofficial),
+    /* 20 */ make_op("JSR", abs, 6),
+    /* 21 */ make_op("AND", idx_ind_x, 6),
+    /* 22 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 23 */ make_op("RLA", idx_ind_x, 8, op_unofficial),
+    /* 24 */ make_op("BIT", zp, 3),
+    /* 25 */ make_op("AND", zp, 3),
+    /* 26 */ make_op("ROL", zp, 5),
+    /* 27 */ make_op("RLA", zp, 5, op_unofficial),
+    /* 28 */ make_op("PLP", impl, 4),
+    /* 29 */ make_op("AND", imm, 2),
+    /* 2A */ make_op("ROL", acc, 2),
+    /* 2B */ make_op("ANC", imm, 2, op_unofficial),
+    /* 2C */ make_op("BIT", abs, 4),
+    /* 2D */ make_op("AND", abs, 4),
+    /* 2E */ make_op("ROL", abs, 6),
+    /* 2F */ make_op("RLA", abs, 6, op_unofficial),
+    /* 30 */ make_op("BMI", rel, 2),
+    /* 31 */ make_op("AND", ind_idx_y, 5, op_page_penalty),
+    /* 32 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 33 */ make_op("RLA", ind_idx_y, 8, op_unofficial),
+    /* 34 */ make_op("NOP", zp_x, 4, op_unofficial),
+    /* 35 */ make_op("AND", zp_x, 4),
+    /* 36 */ make_op("ROL", zp_x, 6),
+    /* 37 */ make_op("RLA", zp_x, 6, op_unofficial),
+    /* 38 */ make_op("SEC", impl, 2),
+    /* 39 */ make_op("AND", abs_y, 4, op_page_penalty),
+    /* 3A */ make_op("NOP", impl, 2, op_unofficial),
+    /* 3B */ make_op("RLA", abs_y, 7, op_unofficial),
+    /* 3C */ make_op("NOP", abs_x, 4, op_page_penalty | op_unofficial),
+    /* 3D */ make_op("AND", abs_x, 4, op_page_penalty),
+    /* 3E */ make_op("ROL", abs_x, 7),
+    /* 3F */ make_op("RLA", abs_x, 7, op_unofficial),
+    /* 40 */ make_op("RTI", impl, 6),
+    /* 41 */ make_op("EOR", idx_ind_x, 6),
+    /* 42 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 43 */ make_op("SRE", idx_ind_x, 8, op_unofficial),
+    /* 44 */ make_op("NOP", zp, 3, op_unofficial),
+    /* 45 */ make_op("EOR", zp, 3),
+    /* 46 */ make_op("LSR", zp, 5),
+    /* 47 */ make_op("SRE", zp, 5, op_unofficial),
+    /* 48 */ make_op("PHA", impl, 3),
+    /* 49 */ make_op("EOR", imm, 2),
+    /* 4A */ make_op("LSR", acc, 2),
+    /* 4B */ make_op("ALR", imm, 2, op_unofficial),
+    /* 4C */ make_op("JMP", abs, 3),
+    /* 4D */ make_op("EOR", abs, 4),
+    /* 4E */ make_op("LSR", abs, 6),
+    /* 4F */ make_op("SRE", abs, 6, op_unofficial),
+    /* 50 */ make_op("BVC", rel, 2),
+    /* 51 */ make_op("EOR", ind_idx_y, 5, op_page_penalty),
+    /* 52 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 53 */ make_op("SRE", ind_idx_y, 8, op_unofficial),
+    /* 54 */ make_op("NOP", zp_x, 4, op_unofficial),
+    /* 55 */ make_op("EOR", zp_x, 4),
+    /* 56 */ make_op("LSR", zp_x, 6),
+    /* 57 */ make_op("SRE", zp_x, 6, op_unofficial),
+    /* 58 */ make_op("CLI", impl, 2),
+    /* 59 */ make_op("EOR", abs_y, 4, op_page_penalty),
+    /* 5A */ make_op("NOP", impl, 2, op_unofficial),
+    /* 5B */ make_op("SRE", abs_y, 7, op_unofficial),
+    /* 5C */ make_op("NOP", abs_x, 4, op_page_penalty | op_unofficial),
+    /* 5D */ make_op("EOR", abs_x, 4, op_page_penalty),
+    /* 5E */ make_op("LSR", abs_x, 7),
+    /* 5F */ make_op("SRE", abs_x, 7, op_unofficial),
+    /* 60 */ make_op("RTS", impl, 6),
+    /* 61 */ make_op("ADC", idx_ind_x, 6),
+    /* 62 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 63 */ make_op("RRA", idx_ind_x, 8, op_unofficial),
+    /* 64 */ make_op("NOP", zp, 3, op_unofficial),
+    /* 65 */ make_op("ADC", zp, 3),
+    /* 66 */ make_op("ROR", zp, 5),
+    /* 67 */ make_op("RRA", zp, 5, op_unofficial),
+    /* 68 */ make_op("PLA", impl, 4),
+    /* 69 */ make_op("ADC", imm, 2),
+    /* 6A */ make_op("ROR", acc, 2),
+    /* 6B */ make_op("ARR", imm, 2, op_unofficial),
+    /* 6C */ make_op("JMP", ind, 5),
+    /* 6D */ make_op("ADC", abs, 4),
+    /* 6E */ make_op("ROR", abs, 6),
+    /* 6F */ make_op("RRA", abs, 6, op_unofficial),
+    /* 70 */ make_op("BVS", rel, 2),
+    /* 71 */ make_op("ADC", ind_idx_y, 5, op_page_penalty),
+    /* 72 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 73 */ make_op("RRA", ind_idx_y, 8, op_unofficial),
+    /* 74 */ make_op("NOP", zp_x, 4, op_unofficial),
+    /* 75 */ make_op("ADC", zp_x, 4),
+    /* 76 */ make_op("ROR", zp_x, 6),
+    /* 77 */ make_op("RRA", zp_x, 6, op_unofficial),
+    /* 78 */ make_op("SEI", impl, 2),
+    /* 79 */ make_op("ADC", abs_y, 4, op_page_penalty),
+    /* 7A */ make_op("NOP", impl, 2, op_unofficial),
+    /* 7B */ make_op("RRA", abs_y, 7, op_unofficial),
+    /* 7C */ make_op("NOP", abs_x, 4, op_page_penalty | op_unofficial),
+    /* 7D */ make_op("ADC", abs_x, 4, op_page_penalty),
+    /* 7E */ make_op("ROR", abs_x, 7),
+    /* 7F */ make_op("RRA", abs_x, 7, op_unofficial),
+    /* 80 */ make_op("NOP", imm, 2, op_unofficial),
+    /* 81 */ make_op("STA", idx_ind_x, 6),
+    /* 82 */ make_op("NOP", imm, 2, op_unofficial),
+    /* 83 */ make_op("SAX", idx_ind_x, 6, op_unofficial),
+    /* 84 */ make_op("STY", zp, 3),
+    /* 85 */ make_op("STA", zp, 3),
+    /* 86 */ make_op("STX", zp, 3),
+    /* 87 */ make_op("SAX", zp, 3, op_unofficial),
+    /* 88 */ make_op("DEY", impl, 2),
+    /* 89 */ make_op("NOP", imm, 2, op_unofficial),
+    /* 8A */ make_op("TXA", impl, 2),
+    /* 8B */ make_op("ANE", imm, 2, op_unofficial),
+    /* 8C */ make_op("STY", abs, 4),
+    /* 8D */ make_op("STA", abs, 4),
+    /* 8E */ make_op("STX", abs, 4),
+    /* 8F */ make_op("SAX", abs, 4, op_unofficial),
+    /* 90 */ make_op("BCC", rel, 2),
+    /* 91 */ make_op("STA", ind_idx_y, 6),
+    /* 92 */ make_op("JAM", impl, 0, op_unofficial),
+    /* 93 */ make_op("SHA", ind_idx_y, 6, op_unofficial | op_unstable),
+    /* 94 */ make_op("STY", zp_x, 4),
+    /* 95 */ make_op("STA", zp_x, 4),
+    /* 96 */ make_op("STX", zp_y, 4),
+    /* 97 */ make_op("SAX", zp_y, 4, op_unofficial),
+    /* 98 */ make_op("TYA", impl, 2),
+    /* 99 */ make_op("STA", abs_y, 5),
+    /* 9A */ make_op("TXS", impl, 2),
+    /* 9B */ make_op("TAS", abs_y, 5, op_unofficial | op_unstable),
+    /* 9C */ make_op("SHY", abs_x, 5, op_unofficial | op_unstable),
+    /* 9D */ make_op("STA", abs_x, 5),
+    /* 9E */ make_op("SHX", abs_y, 5, op_unofficial | op_unstable),
+    /* 9F */ make_op("SHA", abs_y, 5, op_unofficial | op_unstable),
+    /* A0 */ make_op("LDY", imm, 2),
+    /* A1 */ make_op("LDA", idx_ind_x, 6),
+    /* A2 */ make_op("LDX", imm, 2),
+    /* A3 */ make_op("LAX", idx_ind_x, 6, op_unofficial),
+    /* A4 */ make_op("LDY", zp, 3),
+    /* A5 */ make_op("LDA", zp, 3),
+    /* A6 */ make_op("LDX", zp, 3),
+    /* A7 */ make_op("LAX", zp, 3, op_unofficial),
+    /* A8 */ make_op("TAY", impl, 2),
+    /* A9 */ make_op("LDA", imm, 2),
+    /* AA */ make_op("TAX", impl, 2),
+    /* AB */ make_op("LXA", imm, 2, op_unofficial),
+    /* AC */ make_op("LDY", abs, 4),
+    /* AD */ make_op("LDA", abs, 4),
+    /* AE */ make_op("LDX", abs, 4),
+    /* AF */ make_op("LAX", abs, 4, op_unofficial),
+    /* B0 */ make_op("BCS", rel, 2),
+    /* B1 */ make_op("LDA", ind_idx_y, 5, op_page_penalty),
+    /* B2 */ make_op("JAM", impl, 0, op_unofficial),
+    /* B3 */ make_op("LAX", ind_idx_y, 5, op_page_penalty | op_unofficial),
+    /* B4 */ make_op("LDY", zp_x, 4),
+    /* B5 */ make_op("LDA", zp_x, 4),
+    /* B6 */ make_op("LDX", zp_y, 4),
+    /* B7 */ make_op("LAX", zp_y, 4, op_unofficial),
+    /* B8 */ make_op("CLV", impl, 2),
+    /* B9 */ make_op("LDA", abs_y, 4, op_page_penalty),
+    /* BA */ make_op("TSX", impl, 2),
+    /* BB */ make_op("LAS", abs_y, 4,
+                     op_page_penalty | op_unofficial | op_unstable),
+    /* BC */ make_op("LDY", abs_x, 4, op_page_penalty),
+    /* BD */ make_op("LDA", abs_x, 4, op_page_penalty),
+    /* BE */ make_op("LDX", abs_y, 4, op_page_penalty),
+    /* BF */ make_op("LAX", abs_y, 4, op_page_penalty | op_unofficial),
+    /* C0 */ make_op("CPY", imm, 2),
+    /* C1 */ make_op("CMP", idx_ind_x, 6),
+    /* C2 */ make_op("NOP", imm, 2, op_unofficial),
+    /* C3 */ make_op("DCP", idx_ind_x, 8, op_unofficial),
+    /* C4 */ make_op("CPY", zp, 3),
+    /* C5 */ make_op("CMP", zp, 3),
+    /* C6 */ make_op("DEC", zp, 5),
+    /* C7 */ make_op("DCP", zp, 5, op_unofficial),
+    /* C8 */ make_op("INY", impl, 2),
+    /* C9 */ make_op("CMP", imm, 2),
+    /* CA */ make_op("DEX", impl, 2),
+    /* CB */ make_op("SBX", imm, 2, op_unofficial | op_unstable),
+    /* CC */ make_op("CPY", abs, 4),
+    /* CD */ make_op("CMP", abs, 4),
+    /* CE */ make_op("DEC", abs, 6),
+    /* CF */ make_op("DCP", abs, 6, op_unofficial),
+    /* D0 */ make_op("BNE", rel, 2),
+    /* D1 */ make_op("CMP", ind_idx_y, 5, op_page_penalty),
+    /* D2 */ make_op("JAM", impl, 0, op_unofficial),
+    /* D3 */ make_op("DCP", ind_idx_y, 8, op_unofficial),
+    /* D4 */ make_op("NOP", zp_x, 4, op_unofficial),
+    /* D5 */ make_op("CMP", zp_x, 4),
+    /* D6 */ make_op("DEC", zp_x, 6),
+    /* D7 */ make_op("DCP", zp_x, 6, op_unofficial),
+    /* D8 */ make_op("CLD", impl, 2),
+    /* D9 */ make_op("CMP", abs_y, 4, op_page_penalty),
+    /* DA */ make_op("NOP", impl, 2, op_unofficial),
+    /* DB */ make_op("DCP", abs_y, 7, op_unofficial),
+    /* DC */ make_op("NOP", abs_x, 4, op_page_penalty | op_unofficial),
+    /* DD */ make_op("CMP", abs_x, 4, op_page_penalty),
+    /* DE */ make_op("DEC", abs_x, 7),
+    /* DF */ make_op("DCP", abs_x, 7, op_unofficial),
+    /* E0 */ make_op("CPX", imm, 2),
+    /* E1 */ make_op("SBC", idx_ind_x, 6),
+    /* E2 */ make_op("NOP", imm, 2, op_unofficial),
+    /* E3 */ make_op("ISB", idx_ind_x, 8, op_unofficial),
+    /* E4 */ make_op("CPX", zp, 3),
+    /* E5 */ make_op("SBC", zp, 3),
+    /* E6 */ make_op("INC", zp, 5),
+    /* E7 */ make_op("ISB", zp, 5, op_unofficial),
+    /* E8 */ make_op("INX", impl, 2),
+    /* E9 */ make_op("SBC", imm, 2),
+    /* EA */ make_op("NOP", impl, 2),
+    /* EB */ make_op("SBC", imm, 2, op_unofficial),
+    /* EC */ make_op("CPX", abs, 4),
+    /* ED */ make_op("SBC", abs, 4),
+    /* EE */ make_op("INC", abs, 6),
+    /* EF */ make_op("ISB", abs, 6, op_unofficial),
+    /* F0 */ make_op("BEQ", rel, 2),
+    /* F1 */ make_op("SBC", ind_idx_y, 5, op_page_penalty),
+    /* F2 */ make_op("JAM", impl, 0, op_unofficial),
+    /* F3 */ make_op("ISB", ind_idx_y, 8, op_unofficial),
+    /* F4 */ make_op("NOP", zp_x, 4, op_unofficial),
+    /* F5 */ make_op("SBC", zp_x, 4),
+    /* F6 */ make_op("INC", zp_x, 6),
+    /* F7 */ make_op("ISB", zp_x, 6, op_unofficial),
+    /* F8 */ make_op("SED", impl, 2),
+    /* F9 */ make_op("SBC", abs_y, 4, op_page_penalty),
+    /* FA */ make_op("NOP", impl, 2, op_unofficial),
+    /* FB */ make_op("ISB", abs_y, 7, op_unofficial),
+    /* FC */ make_op("NOP", abs_x, 4, op_page_penalty | op_unofficial),
+    /* FD */ make_op("SBC", abs_x, 4, op_page_penalty),
+    /* FE */ make_op("INC", abs_x, 7),
+    /* FF */ make_op("ISB", abs_x, 7, op_unofficial)
+};
+
+static_assert(op_info[0xA9].len == 2 && op_info[0xBD].page_penalty &&
+              !op_info[0xA7].legal && op_info[0x9E].unstable);
+
+/// Returns `true` if the opcode can continue execution anywhere other than
+/// the next instruction.
+constexpr bool op_transfers_control(uint8_t opcode) {
+    switch (opcode) {
+    case 0x00:  // BRK
+    case 0x20:  // JSR
+    case 0x40:  // RTI
+    case 0x4C:  // JMP
+    case 0x60:  // RTS
+    case 0x6C:  // JMP (ind)
+        return true;
+    default: return op_info[opcode].mode == rel;
+    }
+}
+
+/// Returns `true` if the opcode writes to its operand address.
+constexpr bool op_writes_operand(uint8_t opcode) {
+    constexpr std::string_view writes[] = {
+        "STA", "STX", "STY", "SAX", "ASL", "LSR", "ROL", "ROR",
+        "INC", "DEC", "SLO", "RLA", "SRE", "RRA", "DCP", "ISB"};
+    const OpInfo &info = op_info[opcode];
+    if (info.mode == acc) return false;
+    for (std::string_view mnemonic : writes)
+        if (info.mnemonic == mnemonic) return true;
+    return false;
+}
+
+/// Returns `true` if every address in [lo, hi] is internal RAM, PRG RAM or,
+/// for reads, PRG ROM.
+constexpr bool is_memory_range(uint16_t lo, uint16_t hi, bool write) {
+    if (hi < 0x2000) return true;
+    return lo >= 0x6000 && (!write || hi < 0x8000);
+}
+
+/// Returns `true` if all bus accesses of the instruction provably stay in
+/// internal RAM, PRG RAM or, for reads, PRG ROM, so no other device can
+/// observe them. Interrupts serviced after the instruction only touch the
+/// stack and the vectors.
+/// \param operand The two bytes following the opcode, little endian.
+constexpr bool op_memory_only(uint8_t opcode, uint16_t operand) {
+    const OpInfo &info = op_info[opcode];
+    // Unstable opcodes access unpredictable addresses
+    if (info.unstable) return false;
+
+    bool write = op_writes_operand(opcode);
+    switch (info.mode) {
+    case impl:
+    case acc:
+    case imm:
+    case rel:
+    case zp:
+    case zp_x:
+    case zp_y: return true;
+    case abs:
+        // JMP/JSR don't access their operand address
+        return opcode == 0x4C || opcode == 0x20 ||
+               is_memory_range(operand, operand, write);
+    case abs_x:
+    case abs_y:
+        // Dummy reads can hit the page before a crossing
+        return operand <= 0xFF00 &&
+               is_memory_range(operand & 0xFF00, operand + 0xFF, write);
+    case ind:
+        return is_memory_range(operand & 0xFF00, operand | 0xFF, false);
+    default:
+        // Indirect targets aren't known ahead of time
+        return false;
+    }
+}
+
+static_assert(op_memory_only(0xAD, 0x0300) && !op_memory_only(0xAD, 0x2002) &&
+              !op_memory_only(0x8D, 0x8000) && op_memory_only(0x4C, 0x2000));
+
+}  // namespace NES
+
+#endif  // INC_2A03_OPCODES_H
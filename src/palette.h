@@ -4,6 +4,7 @@
 #include <log.h>
 #include <stdint.h>
 
+#include <array>
 #include <cassert>
 #include <format>
 #include <fstream>
@@ -22,20 +23,54 @@ class Palette {
         uint8_t b;
     };
 
-    std::array<uint8_t, 0xC0> data;
+    static const size_t colors = 0x40;     ///< NES colors
+    static const size_t emphasis = 8;      ///< PPUMASK emphasis combinations
+    static const uint8_t gray_mask = 0x30; ///< Keeps the gray column
+
+    /// RGB triplets of the file: 64 colors, optionally followed by the 448
+    /// colors of the other emphasis combinations
+    std::array<uint8_t, colors * emphasis * 3> data;
+    /// RGBA of every color, indexed by `emphasis_bits << 6 | color`. The
+    /// emphasis bits are PPUMASK bits 5-7 (R, G, B).
+    std::array<uint32_t, colors * emphasis> rgba;
 
     Palette() = delete;
     explicit Palette(std::string filename) {
         std::ifstream ifs(filename, std::ios::binary);
         assert(ifs.is_open());
         ifs.read(reinterpret_cast<char*>(data.data()), data.size());
+        size_t size = ifs.gcount();
+        assert(size >= colors * 3);
+
+        for (size_t idx = 0; idx < rgba.size(); idx++) {
+            size_t emph = idx / colors;
+            Color c;
+            if (size == data.size() || emph == 0) {
+                c = {data[idx * 3], data[idx * 3 + 1], data[idx * 3 + 2]};
+            } else {
+                // Each emphasis bit darkens the other two channels, once
+                // however many of the other bits are set
+                size_t base = (idx % colors) * 3;
+                c = {attenuate(data[base], emph & ~0x1),
+                     attenuate(data[base + 1], emph & ~0x2),
+                     attenuate(data[base + 2], emph & ~0x4)};
+            }
+            rgba[idx] = (c.r << 24) | (c.g << 16) | (c.b << 8) | 0xFF;
+        }
     };
 
-    uint32_t get_rgba(uint8_t idx) {
-        uint8_t offset = idx * 3;
-        uint32_t retval = (data[offset] << 24) | (data[offset + 1] << 16) |
-                          (data[offset + 2] << 8) | 0xFF;
-        return retval;
+    /// Returns the RGBA of a color as PPUMASK displays it.
+    /// \param idx Color, palette RAM only keeps its low 6 bits
+    /// \param mask PPUMASK value
+    uint32_t get_rgba(uint8_t idx, uint8_t mask = 0x0) const {
+        if (mask & 0x1) idx &= gray_mask;
+        return rgba[(mask >> 5) << 6 | (idx & 0x3F)];
+    }
+
+   private:
+    static uint8_t attenuate(uint8_t channel, bool darken) {
+        // Approximation of the 2C02 emphasis attenuation
+        return darken ? channel * 0.816328 : channel;
     }
 };
 
@@ -0,0 +1,175 @@
+#include <pixel.h>
+
+// SSE2 is part of x86-64, later extensions are only used if the CPU has them
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define NES_PIXEL_X86
+#endif
+
+namespace NES {
+namespace Pixel {
+
+namespace {
+uint8_t compose_scalar(const Input &in, uint16_t *out) {
+    uint8_t hits = 0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t bg = (in.bg >> (14 - i * 2)) & 0x3;
+        uint8_t at = (in.at >> (14 - i * 2)) & 0x3;
+        uint8_t spr = in.spr[i];
+
+        // Color 0 of every background palette is the backdrop
+        uint8_t idx = bg ? bg | at << 2 : 0;
+        bool shown = in.bg_show;
+        if (spr & spr_color) {
+            if ((spr & spr_zero) && bg) hits |= 1 << i;
+            if (!(spr & spr_behind) || !bg) {
+                idx = 0x10 | (spr & (spr_palette | spr_color));
+                shown = true;
+            }
+        }
+        out[i] = shown ? in.colors[idx] | in.emphasis : blank;
+    }
+    return hits;
+}
+
+void to_rgba_scalar(const uint16_t *in, size_t size, const uint32_t *rgba,
+                    uint32_t *out) {
+    for (size_t i = 0; i < size; i++) out[i] = rgba[in[i]];
+}
+
+#ifdef NES_PIXEL_X86
+/// Palette RAM indices of the 8 pixels and the masks the kernels share,
+/// in 16-bit lanes.
+struct Lanes {
+    __m128i idx;    ///< Palette RAM index
+    __m128i shown;  ///< Pixel isn't transparent black
+    uint8_t hits;   ///< Sprite 0 hits
+};
+
+/// Works out which pixel wins and its palette RAM index, 8 at a time.
+/// Inlined into the SSSE3 kernel, so only SSE2 may be used.
+inline __attribute__((always_inline)) Lanes priority(const Input &in) {
+    const __m128i zero = _mm_setzero_si128();
+    // Multiplying lane i by 4^i shifts pixel i to the top bits
+    const __m128i pixel_shift =
+        _mm_setr_epi16(1, 4, 16, 64, 256, 1024, 4096, 16384);
+    __m128i bg = _mm_srli_epi16(
+        _mm_mullo_epi16(_mm_set1_epi16(in.bg), pixel_shift), 14);
+    __m128i at = _mm_srli_epi16(
+        _mm_mullo_epi16(_mm_set1_epi16(in.at), pixel_shift), 14);
+    __m128i bg_opaque = _mm_cmpgt_epi16(bg, zero);
+    __m128i bg_idx =
+        _mm_and_si128(_mm_or_si128(bg, _mm_slli_epi16(at, 2)), bg_opaque);
+
+    __m128i spr = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in.spr)), zero);
+    auto has = [&](uint8_t bits) {
+        return _mm_cmpgt_epi16(_mm_and_si128(spr, _mm_set1_epi16(bits)),
+                               zero);
+    };
+    __m128i spr_opaque = has(spr_color);
+    __m128i spr_front = _mm_andnot_si128(
+        _mm_and_si128(has(spr_behind), bg_opaque), spr_opaque);
+    __m128i spr_idx = _mm_or_si128(
+        _mm_and_si128(spr, _mm_set1_epi16(spr_palette | spr_color)),
+        _mm_set1_epi16(0x10));
+    __m128i hit =
+        _mm_and_si128(_mm_and_si128(has(spr_zero), spr_opaque), bg_opaque);
+
+    Lanes lanes;
+    lanes.idx = _mm_or_si128(_mm_and_si128(spr_front, spr_idx),
+                             _mm_andnot_si128(spr_front, bg_idx));
+    lanes.shown = in.bg_show ? _mm_cmpeq_epi16(zero, zero) : spr_front;
+    lanes.hits = _mm_movemask_epi8(_mm_packs_epi16(hit, zero));
+    return lanes;
+}
+
+/// Blends the colors with the blank pixels and stores them.
+inline __attribute__((always_inline)) void store(const Lanes &lanes,
+                                                 __m128i colors,
+                                                 uint16_t *out) {
+    __m128i pixels =
+        _mm_or_si128(_mm_and_si128(lanes.shown, colors),
+                     _mm_andnot_si128(lanes.shown, _mm_set1_epi16(blank)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), pixels);
+}
+
+uint8_t compose_sse2(const Input &in, uint16_t *out) {
+    Lanes lanes = priority(in);
+    // No byte shuffles in SSE2, colors are looked up one by one
+    alignas(16) uint16_t idx[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(idx), lanes.idx);
+    for (int i = 0; i < 8; i++) idx[i] = in.colors[idx[i]];
+    __m128i colors = _mm_load_si128(reinterpret_cast<const __m128i *>(idx));
+    store(lanes, _mm_or_si128(colors, _mm_set1_epi16(in.emphasis)), out);
+    return lanes.hits;
+}
+
+__attribute__((target("ssse3"))) uint8_t compose_ssse3(const Input &in,
+                                                       uint16_t *out) {
+    Lanes lanes = priority(in);
+    // A shuffle per 16 palette RAM entries, indices with the top bit set
+    // select 0
+    __m128i idx = _mm_packus_epi16(lanes.idx, _mm_setzero_si128());
+    __m128i high = _mm_cmpgt_epi8(idx, _mm_set1_epi8(0x0F));
+    __m128i low = _mm_cmplt_epi8(idx, _mm_set1_epi8(0x10));
+    __m128i pram_l =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in.colors));
+    __m128i pram_h =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in.colors + 16));
+    __m128i colors =
+        _mm_or_si128(_mm_shuffle_epi8(pram_l, _mm_or_si128(idx, high)),
+                     _mm_shuffle_epi8(pram_h, _mm_or_si128(idx, low)));
+    colors = _mm_unpacklo_epi8(colors, _mm_setzero_si128());
+    store(lanes, _mm_or_si128(colors, _mm_set1_epi16(in.emphasis)), out);
+    return lanes.hits;
+}
+
+__attribute__((target("avx2"))) void to_rgba_avx2(const uint16_t *in,
+                                                  size_t size,
+                                                  const uint32_t *rgba,
+                                                  uint32_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i idx = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(out + i),
+            _mm256_i32gather_epi32(reinterpret_cast<const int *>(rgba), idx,
+                                   4));
+    }
+    to_rgba_scalar(in + i, size - i, rgba, out + i);
+}
+#endif
+}  // namespace
+
+uint8_t sprite0_hits(const Input &in) {
+    uint8_t hits = 0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t spr = in.spr[i];
+        bool bg = (in.bg >> (14 - i * 2)) & 0x3;
+        if ((spr & spr_zero) && (spr & spr_color) && bg) hits |= 1 << i;
+    }
+    return hits;
+}
+
+std::vector<Implementation> implementations() {
+    std::vector<Implementation> impls = {
+        {"scalar", compose_scalar, to_rgba_scalar}};
+#ifdef NES_PIXEL_X86
+    impls.push_back({"sse2", compose_sse2, to_rgba_scalar});
+    if (__builtin_cpu_supports("ssse3")) {
+        impls.push_back({"ssse3", compose_ssse3, to_rgba_scalar});
+        // Checks CPUID, and that the OS saves the AVX registers
+        if (__builtin_cpu_supports("avx2"))
+            impls.push_back({"avx2", compose_ssse3, to_rgba_avx2});
+    }
+#endif
+    return impls;
+}
+
+const Kernel compose = implementations().back().compose;
+const Converter to_rgba = implementations().back().to_rgba;
+
+}  // namespace Pixel
+}  // namespace NES
@@ -0,0 +1,72 @@
+#ifndef INC_2A03_PIXEL_H
+#define INC_2A03_PIXEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NES {
+namespace Pixel {
+
+/// Fields of a sprite pixel in `Input::spr`. A pixel with color 0 is
+/// transparent.
+enum SpriteBits : uint8_t {
+    spr_color = 0x03,    ///< Pattern color 0-3
+    spr_palette = 0x0C,  ///< Sprite palette 0-3
+    spr_behind = 0x10,   ///< Behind the background
+    spr_zero = 0x20,     ///< Comes from sprite 0
+};
+
+/// Color of the pixels nothing is shown in, $0F is black with any emphasis.
+const uint16_t blank = 0x0F;
+
+/// Everything needed to compose 8 pixels of a scanline.
+struct Input {
+    /// Background colors, 8 packed 2-bit ones, the first in the top bits.
+    uint16_t bg;
+    uint16_t at;             ///< Background palettes, packed the same way
+    bool bg_show;            ///< Background shown, else it's transparent black
+    const uint8_t *spr;      ///< 8 sprite pixels, see `SpriteBits`
+    const uint8_t *colors;   ///< Colors of the 32 palette RAM entries
+    uint16_t emphasis;       ///< PPUMASK emphasis bits, shifted left by 6
+};
+
+/// Composes 8 pixels: picks the background or sprite pixel by priority and
+/// looks up its color.
+/// \param in Pixels to compose
+/// \param out 8 pixels, `Palette::rgba` indices
+/// \return Mask of the pixels where sprite 0 overlaps an opaque background
+/// pixel, bit 0 for the first one
+using Kernel = uint8_t (*)(const Input &in, uint16_t *out);
+
+/// Converts pixels to RGBA.
+/// \param in Pixels, `Palette::rgba` indices
+/// \param size Pixel count
+/// \param rgba `Palette::rgba`
+/// \param out RGBA pixels
+using Converter = void (*)(const uint16_t *in, size_t size,
+                           const uint32_t *rgba, uint32_t *out);
+
+/// Returns the sprite 0 hits of 8 pixels without composing them, see
+/// `Kernel`.
+uint8_t sprite0_hits(const Input &in);
+
+/// Kernel implementation, all of them give identical results.
+struct Implementation {
+    const char *name;
+    Kernel compose;
+    Converter to_rgba;
+};
+
+/// Returns the kernels the CPU supports, the scalar one first and the
+/// fastest last. Support is detected at runtime with CPUID.
+std::vector<Implementation> implementations();
+
+/// Fastest kernels the CPU supports.
+extern const Kernel compose;
+extern const Converter to_rgba;
+
+}  // namespace Pixel
+}  // namespace NES
+
+#endif  // INC_2A03_PIXEL_H
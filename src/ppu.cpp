@@ -1,7 +1,9 @@
 #include <gui.h>
 #include <log.h>
+#include <pixel.h>
 #include <ppu.h>
 
+#include <algorithm>
 #include <cstring>
 #include <format>
 #include <iomanip>
@@ -47,6 +49,130 @@ void set_vert(PPUVramAddr &to, const PPUVramAddr &from) {
     to.sc_fine_y = from.sc_fine_y;
 }
 
+namespace {
+/// Kind of scanline, lines of the same kind do the same work on a dot.
+enum LineClass {
+    line_visible,    ///< Visible lines 0-238
+    line_last,       ///< Last visible line 239, ends the frame
+    line_post,       ///< Post-render line 240
+    line_vbl_start,  ///< Line 241, sets VBlank
+    line_vbl,        ///< VBlank lines 242-260
+    line_pre,        ///< Pre-render line 261
+    line_class_count
+};
+
+/// Returns the kind of a scanline.
+constexpr LineClass line_class(uint16_t y) {
+    if (y < 239) return line_visible;
+    if (y == 239) return line_last;
+    if (y == 240) return line_post;
+    if (y == 241) return line_vbl_start;
+    return y == ntsc_y - 1 ? line_pre : line_vbl;
+}
+
+/// Work done on a dot, in the order `PPU::execute` does it.
+enum DotAction : uint16_t {
+    act_vbl_set = 1 << 0,        ///< Set VBlank, signal the NMI
+    act_bg_addr = 1 << 1,        ///< Put the BG pattern address on the bus
+    act_draw = 1 << 2,           ///< Draw 8 pixels
+    act_shift = 1 << 3,          ///< Shift the BG shift registers
+    act_flags_clear = 1 << 4,    ///< Clear the status flags
+    act_oam_sec_clear = 1 << 5,  ///< Clear a byte of secondary OAM
+    act_sprite_eval = 1 << 6,    ///< Evaluate sprites for the next line
+    act_sprite_fetch = 1 << 7,   ///< Fetch sprites for the next line
+    act_oamaddr_clear = 1 << 8,  ///< Clear OAMADDR
+    act_inc_vert = 1 << 9,       ///< Increment the vertical scroll
+    act_set_hori = 1 << 10,      ///< Copy the horizontal scroll from t
+    act_set_vert = 1 << 11,      ///< Copy the vertical scroll from t
+    act_end_frame = 1 << 12,     ///< Present the frame
+};
+
+/// Actions skipped while rendering is disabled.
+const uint16_t act_rendering =
+    act_bg_addr | act_inc_vert | act_set_hori | act_set_vert;
+
+/// Step of the background fetches done on a dot, only while rendering.
+enum FetchStep : uint8_t {
+    fetch_none,
+    fetch_nt_addr,
+    fetch_nt,
+    fetch_at_addr,
+    fetch_at,
+    fetch_bgl_addr,
+    fetch_bgl,  ///< Latches the low bitplane, from the tile cache
+    fetch_bgh_addr,
+    fetch_bgh,  ///< Latches the high bitplane, reloads the shift registers
+};
+
+/// Entry of `dot_table`.
+struct DotInfo {
+    uint16_t actions;  ///< `DotAction` flags
+    FetchStep fetch;   ///< Background fetch
+    /// Dots from this one on, up to the end of the line, with nothing to do
+    /// but shifting. Indexed by whether rendering is enabled.
+    uint16_t idle[2];
+};
+
+/// Returns the actions of a dot.
+constexpr uint16_t dot_actions(LineClass cls, uint16_t x) {
+    bool visible = cls == line_visible || cls == line_last;
+    bool fetching = visible || cls == line_pre;
+    uint16_t a = 0;
+    if (cls == line_vbl_start && x == 1) a |= act_vbl_set;
+    if ((visible || cls == line_post) && x == 0) a |= act_bg_addr;
+    if (visible && x >= 1 && x <= 249 && !((x - 1) % 8)) a |= act_draw;
+    if (x >= 2 && x <= 337) a |= act_shift;
+    if (cls == line_pre && x == 1) a |= act_flags_clear;
+    if (visible && x >= 1 && x <= 64) a |= act_oam_sec_clear;
+    if (visible && x == 65) a |= act_sprite_eval;
+    if (visible && x == 257) a |= act_sprite_fetch;
+    if (!fetching) return a;
+    if (x >= 257 && x <= 320) a |= act_oamaddr_clear;
+    if (x == 256) a |= act_inc_vert;
+    if (x == 257) a |= act_set_hori;
+    if (cls == line_pre && x >= 280 && x <= 304) a |= act_set_vert;
+    if (cls == line_last && x == 320) a |= act_end_frame;
+    return a;
+}
+
+/// Returns the background fetch step of a dot.
+constexpr FetchStep dot_fetch(LineClass cls, uint16_t x) {
+    if (cls != line_visible && cls != line_last && cls != line_pre)
+        return fetch_none;
+    // Tiles for this line and the first two of the next one
+    if ((x >= 1 && x <= 256) || (x >= 321 && x <= 336))
+        return FetchStep(fetch_nt_addr + (x - 1) % 8);
+    // Unused nametable fetches during sprite fetches and at the end
+    if ((x >= 257 && x <= 320 && !((x - 1) % 8)) || x == 259 || x == 337 ||
+        x == 339)
+        return fetch_nt_addr;
+    if ((x >= 258 && x <= 320 && !((x - 2) % 8)) || x == 260 || x == 338 ||
+        x == 340)
+        return fetch_nt;
+    return fetch_none;
+}
+
+/// Work of every dot, indexed by `LineClass` and dot.
+constexpr auto dot_table = [] {
+    std::array<std::array<DotInfo, ntsc_x>, line_class_count> table{};
+    for (int cls = 0; cls < line_class_count; cls++) {
+        uint16_t idle[2] = {0, 0};
+        for (int x = ntsc_x - 1; x >= 0; x--) {
+            DotInfo &d = table[cls][x];
+            d.actions = dot_actions(LineClass(cls), x);
+            d.fetch = dot_fetch(LineClass(cls), x);
+            bool busy = d.actions & ~act_shift;
+            bool busy_off = d.actions & ~act_shift & ~act_rendering;
+            idle[1] = busy || d.fetch != fetch_none ? 0 : idle[1] + 1;
+            idle[0] = busy_off ? 0 : idle[0] + 1;
+            d.idle[0] = idle[0];
+            d.idle[1] = idle[1];
+        }
+    }
+    return table;
+}();
+}  // namespace
+
 PPU::PPU(GFX::GUI &_gui, NES::Palette _pal)
     : mapper(nullptr), gui(_gui), pal(std::move(_pal)) {
     power();
@@ -62,14 +188,10 @@ void PPU::power() {
     cpu_bus = 0x0;
     nt = 0x0;
     at = 0x0;
-    at_latch_l = 0x0;
-    at_latch_h = 0x0;
-    bg_latch_l = 0x0;
-    bg_latch_h = 0x0;
-    bg_l_shift = 0x0;
-    bg_h_shift = 0x0;
-    at_l_shift = 0x0;
-    at_h_shift = 0x0;
+    at_latch = 0x0;
+    bg_latch = 0x0;
+    bg_shift = 0x0;
+    at_shift = 0x0;
     ppuctrl.value = 0x0;
     ppumask.value = 0x0;
     ppustatus.value = 0x0;
@@ -78,6 +200,8 @@ void PPU::power() {
     oam_overflow = false;
     oam_sec_overflow = false;
     spr0_in_range = false;
+    spr0_on_line = false;
+    render_frame = render_interval != 0;
     ppudata_buf = 0x0;
     scan_x = 0;
     scan_y = 0;
@@ -88,9 +212,80 @@ void PPU::power() {
     std::fill(oam.begin(), oam.end(), 0x3F);
     std::fill(oam_sec.begin(), oam_sec.end(), 0x3F);
     std::fill(pram.begin(), pram.end(), 0xFF);
-    spr_out.fill({0, 0, 0, 0});
-    std::fill(fb.begin(), fb.end(), 0x000000FF);
-    std::fill(fb_sec.begin(), fb_sec.end(), 0x000000FF);
+    for (uint8_t idx = 0; idx < pram_sz; idx++) update_pram_color(idx);
+    chr_valid.fill(false);
+    spr_line.fill(0x0);
+    std::fill(fb.begin(), fb.end(), Pixel::blank);
+    std::fill(fb_sec.begin(), fb_sec.end(), Pixel::blank);
+}
+
+void PPU::set_mapper(iNESv1::Mapper::Base *_mapper) {
+    mapper = _mapper;
+    if (mapper)
+        mapper->on_chr_bank_switch.push_back(
+            [this](uint16_t addr, uint16_t size) {
+                invalidate_chr(addr, size);
+                map_pages();
+            });
+    chr_valid.fill(false);
+    map_pages();
+}
+
+void PPU::map_pages() {
+    nt_page.fill(nullptr);
+    chr_page.fill(nullptr);
+    if (!mapper) return;
+
+    // VRAM page of each nametable, -1 for cartridge VRAM
+    static const int layouts[4][4] = {
+        {0, 0, 1, 1},    // map_hori
+        {0, 1, 0, 1},    // map_vert
+        {0, 0, 0, 0},    // map_single
+        {0, 1, -1, -1},  // map_quad
+    };
+    const int *layout = layouts[mapper->mirroring()];
+    for (int i = 0; i < 4; i++) {
+        if (layout[i] >= 0) nt_page[i] = &vram[layout[i] * 0x400];
+    }
+    for (int i = 0; i < 8; i++) chr_page[i] = mapper->chr_page(i * 0x400);
+}
+
+void PPU::invalidate_chr(uint16_t addr, uint16_t size) {
+    size_t end = std::min<size_t>((addr + size + 0xF) >> 4, chr_tiles);
+    for (size_t tile = addr >> 4; tile < end; tile++) chr_valid[tile] = false;
+}
+
+uint16_t PPU::bitplane(uint32_t packed, int plane) {
+    uint16_t bits = 0x0;
+    for (int i = 0; i < 16; i++)
+        bits |= ((packed >> (i * 2 + plane)) & 1) << i;
+    return bits;
+}
+
+uint16_t PPU::decode_row(uint8_t pat_l, uint8_t pat_h, bool flip) {
+    uint16_t px = 0x0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t color = ((pat_h >> i) & 1) << 1 | ((pat_l >> i) & 1);
+        px |= color << ((flip ? 7 - i : i) * 2);
+    }
+    return px;
+}
+
+void PPU::decode_tile(uint16_t tile) {
+    for (int row = 0; row < 8; row++) {
+        uint8_t pat_l = read(tile << 4 | row);
+        uint8_t pat_h = read((tile << 4 | row) + 8);
+        chr_rows[tile * 8 + row] = decode_row(pat_l, pat_h, false);
+        chr_rows_flip[tile * 8 + row] = decode_row(pat_l, pat_h, true);
+    }
+    chr_valid[tile] = true;
+}
+
+uint16_t PPU::chr_plane(uint16_t addr, int plane) {
+    if (addr >= 0x2000) return decode_row(read(addr), 0x0, false) << plane;
+    // The byte is either bitplane of a cached row
+    uint16_t row = chr_row(addr & ~0x8) >> ((addr >> 3) & 1);
+    return (row & 0x5555) << plane;
 }
 
 void PPU::oam_sec_clear() {
@@ -140,21 +335,17 @@ void PPU::sprite_fetch() {
 
     uint8_t spr_height = ppuctrl.spr_size ? 16 : 8;
 
+    // The first opaque pixel in slot order wins
+    spr_line.fill(0x0);
+    spr0_on_line = false;
     for (int i = 0; i < 8; i++) {
         uint8_t sprite_y  = oam_sec[i * 4 + 0];
         uint8_t tile_idx  = oam_sec[i * 4 + 1];
         uint8_t attr      = oam_sec[i * 4 + 2];
         uint8_t sprite_x  = oam_sec[i * 4 + 3];
 
-        spr_out[i].attr = attr;
-        spr_out[i].x = sprite_x;
-
         // Empty slot (secondary OAM cleared to 0xFF)
-        if (sprite_y == 0xFF) {
-            spr_out[i].pat_l = 0;
-            spr_out[i].pat_h = 0;
-            continue;
-        }
+        if (sprite_y == 0xFF) continue;
 
         uint8_t row = scan_y - sprite_y;
 
@@ -180,328 +371,327 @@ void PPU::sprite_fetch() {
             tile_addr = pt | (tile_num << 4) | row;
         }
 
-        uint8_t pat_l = read(tile_addr);
-        uint8_t pat_h = read(tile_addr + 8);
-
-        // Horizontal flip: reverse bit order
-        if (attr & 0x40) {
-            pat_l = (pat_l & 0xF0) >> 4 | (pat_l & 0x0F) << 4;
-            pat_l = (pat_l & 0xCC) >> 2 | (pat_l & 0x33) << 2;
-            pat_l = (pat_l & 0xAA) >> 1 | (pat_l & 0x55) << 1;
-            pat_h = (pat_h & 0xF0) >> 4 | (pat_h & 0x0F) << 4;
-            pat_h = (pat_h & 0xCC) >> 2 | (pat_h & 0x33) << 2;
-            pat_h = (pat_h & 0xAA) >> 1 | (pat_h & 0x55) << 1;
+        // Horizontal flip uses the mirrored row. Rows past the tile, left
+        // by a sprite size change since evaluation, aren't cached.
+        uint16_t pat;
+        if (tile_addr & 0x8)
+            pat = decode_row(read(tile_addr), read(tile_addr + 8), attr & 0x40);
+        else
+            pat = chr_row(tile_addr, attr & 0x40);
+        if (!pat) continue;
+
+        uint8_t bits = (attr & 0x03) << 2;
+        if (attr & 0x20) bits |= Pixel::spr_behind;
+        // Sprite 0 hit: spr0 in range, first secondary OAM entry
+        if (i == 0 && spr0_in_range) {
+            bits |= Pixel::spr_zero;
+            spr0_on_line = true;
         }
 
-        spr_out[i].pat_l = pat_l;
-        spr_out[i].pat_h = pat_h;
+        int end = std::min<int>(sprite_x + 8, ntsc_fb_x);
+        for (int px = sprite_x; px < end; px++) {
+            uint8_t color = (pat >> ((7 - (px - sprite_x)) * 2)) & 0x3;
+            if (color && !spr_line[px]) spr_line[px] = bits | color;
+        }
     }
 }
 
 void PPU::draw() {
-    uint32_t out[8] = {0};
-    uint8_t bg_color[8] = {0};
+    // Frames that aren't rendered only need sprite 0 hits
+    if (!render_frame && !(spr0_on_line && ppumask.bg_show &&
+                           ppumask.spr_show && !ppustatus.spr0_hit))
+        return;
 
+    Pixel::Input in;
+    in.bg = 0x0;
+    in.at = 0x0;
+    in.bg_show = ppumask.bg_show;
     if (ppumask.bg_show) {
-        uint16_t pix_mask = 0x8000;
-
         NES_LOG("PPU") << std::format(
-            "BGL: 0x{:04X} BGH: {:04X} x.fine: 0x {:02X}\n", bg_l_shift,
-            bg_h_shift, (uint16_t)x.fine);
-
-        for (int i = 0; i < 8; i++) {
-            uint8_t bg = ((bg_l_shift << x.fine) & pix_mask) >> (15 - i) |
-                         ((bg_h_shift << x.fine) & pix_mask) >> (14 - i);
-            uint8_t at_pal =
-                (((at_l_shift << x.fine) & pix_mask) >> (15 - i)) |
-                (((at_h_shift << x.fine) & pix_mask) >> (14 - i));
-            NES_LOG("PPU") << std::format("bg: {:d}, pram@{:02X}={:02X}\n", bg,
-                                          (bg | at_pal << 2),
-                                          pram[bg | (at_pal << 2)]);
-            bg_color[i] = bg;
-            if (bg == 0) {
-                out[i] = pal.get_rgba(pram[0]);
-            } else {
-                out[i] = pal.get_rgba(pram[bg | (at_pal << 2)]);
+            "BGL: 0x{:04X} BGH: {:04X} x.fine: 0x {:02X}\n",
+            bitplane(bg_shift, 0), bitplane(bg_shift, 1), (uint16_t)x.fine);
+
+        // Pixels 0-7 after the fine X scroll are in the top 16 bits
+        in.bg = (bg_shift << (x.fine * 2)) >> 16;
+        in.at = (at_shift << (x.fine * 2)) >> 16;
+        if (NES_LOG_ENABLED("PPU")) {
+            for (int i = 0; i < 8; i++) {
+                uint8_t idx = (in.bg >> (14 - i * 2)) & 0x3;
+                idx |= ((in.at >> (14 - i * 2)) & 0x3) << 2;
+                NES_LOG("PPU") << std::format("bg: {:d}, pram@{:02X}={:02X}\n",
+                                              idx & 0x3, idx, pram[idx]);
             }
-            pix_mask >>= 1;
         }
     }
 
-    // Sprites
-    if (ppumask.spr_show) {
-        uint16_t px_base = scan_x - 1;
+    // Sprite pixels come from the line the last sprite fetch rendered
+    static const uint8_t no_sprites[8] = {0};
+    in.spr = ppumask.spr_show ? &spr_line[scan_x - 1] : no_sprites;
+    in.colors = pram_color.data();
+    in.emphasis = (ppumask.value >> 5) << 6;
+
+    uint8_t hits;
+    if (render_frame) {
+        int y_offset = scan_y * ntsc_fb_x;
+        int x_offset = scan_x - 1;
+        int offset = y_offset + x_offset;
+        uint16_t *fb_ptr = fb_prim ? fb.data() : fb_sec.data();
+        hits = Pixel::compose(in, fb_ptr + offset);
+    } else {
+        hits = Pixel::sprite0_hits(in);
+    }
 
-        for (int i = 0; i < 8; i++) {
-            uint16_t px = px_base + i;
+    // Both BG and sprite pixels non-transparent, x != 255
+    if (scan_x == 249) hits &= 0x7F;
+    if (hits) ppustatus.spr0_hit = true;
+}
 
-            for (int s = 0; s < 8; s++) {
-                uint8_t spr_x = spr_out[s].x;
+void PPU::fetch_tile() {
+    bus.addr = 0x2000 | (v.addr & 0x0FFF);
+    nt = read(bus.addr);
+    bus.addr = 0x23C0 | (v.addr & 0x0C00) | ((v.addr >> 4) & 0x38) |
+               ((v.addr >> 2) & 0x07);
+    at = read(bus.addr);
+    at_latch = (at >> ((v.sc_x & 2) | ((v.sc_y & 2) << 1))) & 0x3;
+    bus.addr = (ppuctrl.bg_pt_addr ? 0x1000 : 0x0000) | (nt << 4) |
+               v.sc_fine_y;
+    bg_latch = chr_row(bus.addr);
+    bus.addr += 8;
+}
 
-                if (px < spr_x || px >= spr_x + 8) continue;
+void PPU::shift(uint8_t dots) {
+    // 2 bits per dot, a full 32-bit shift is undefined
+    bg_shift = dots < 16 ? bg_shift << (dots * 2) : 0x0;
+    at_shift = dots < 16 ? at_shift << (dots * 2) : 0x0;
+}
 
-                uint8_t bit = 7 - (px - spr_x);
-                uint8_t color = ((spr_out[s].pat_h >> bit) & 1) << 1
-                              | ((spr_out[s].pat_l >> bit) & 1);
+void PPU::reload_shifts() {
+    bg_shift |= bg_latch;
+    at_shift |= at_latch * 0x5555u;
+}
 
-                if (color == 0) continue;
+void PPU::render_line() {
+    bool rendering = ppumask.bg_show || ppumask.spr_show;
+
+    // Dots 1-256, a tile every 8 dots, drawn before it is shifted out
+    std::fill(oam_sec.begin(), oam_sec.end(), 0xFF);
+    for (uint16_t dot = 1; dot <= 256; dot += 8) {
+        scan_x = dot;
+        draw();
+        // Sprites for the next line are evaluated on dot 65
+        if (dot == 65) {
+            oam_overflow = false;
+            oam_sec_overflow = false;
+            oam_sec_addr = 0x0;
+            sprite_eval();
+        }
+        shift(dot == 1 ? 7 : 8);
+        if (!rendering) continue;
+        fetch_tile();
+        reload_shifts();
+        if (dot == 249) inc_vert(v);
+        inc_hori(v);
+    }
 
-                // Sprite 0 hit: spr0 in range, first secondary OAM entry,
-                // both BG and sprite pixels non-transparent, x != 255,
-                // both rendering flags enabled
-                if (s == 0 && spr0_in_range && bg_color[i] != 0
-                    && px != 255 && ppumask.bg_show) {
-                    ppustatus.spr0_hit = true;
-                }
+    // Dots 257-320, sprite fetches and garbage nametable fetches
+    scan_x = 257;
+    sprite_fetch();
+    oamaddr = 0x0;
+    bg_shift = at_shift = 0x0;
+    if (rendering) {
+        bus.addr = 0x2000 | (v.addr & 0x0FFF);
+        nt = read(bus.addr);
+        set_hori(v, t);
+        for (uint16_t dot = 259; dot <= 313; dot += dot == 259 ? 6 : 8) {
+            bus.addr = 0x2000 | (v.addr & 0x0FFF);
+            nt = read(bus.addr);
+        }
+    }
 
-                bool behind_bg = spr_out[s].attr & 0x20;
-                uint8_t spr_pal = spr_out[s].attr & 0x03;
+    // Dots 321-336, first two tiles of the next line
+    for (int tile = 0; tile < 2; tile++) {
+        shift(8);
+        if (!rendering) continue;
+        fetch_tile();
+        reload_shifts();
+        inc_hori(v);
+    }
 
-                if (!behind_bg || bg_color[i] == 0) {
-                    out[i] = pal.get_rgba(pram[0x10 | (spr_pal << 2) | color]);
-                }
+    // Dots 337-340, unused nametable fetches
+    shift(1);
+    if (rendering) {
+        for (int i = 0; i < 2; i++) {
+            bus.addr = 0x2000 | (v.addr & 0x0FFF);
+            nt = read(bus.addr);
+        }
+    }
 
-                break;  // First non-transparent sprite wins
-            }
+    if (scan_y == 239) end_frame();
+    scan_x = 0;
+    scan_y++;
+}
+
+void PPU::end_frame() {
+    if (render_frame) {
+        if (!headless) {
+            uint16_t *fbptr = fb_prim ? fb.data() : fb_sec.data();
+            gui.draw_frame(fbptr, pal.rgba.data());
         }
+        fb_prim = !fb_prim;
+        render_count++;
     }
+    frame_count++;
+    render_frame = render_interval && frame_count % render_interval == 0;
+}
 
-    int y_offset = scan_y * ntsc_fb_x;
-    int x_offset = scan_x - 1;
-    int offset = y_offset + x_offset;
-    uint32_t *fb_ptr = fb_prim ? fb.data() : fb_sec.data();
-    std::memcpy(fb_ptr + offset, out, sizeof(uint32_t) * 8);
+void PPU::sync(Timestamp until) {
+    while (until >= synced + ppu_dot_ticks) {
+        Timestamp dots = std::min<Timestamp>((until - synced) / ppu_dot_ticks,
+                                             0xFFFF);
+        execute(uint16_t(dots));
+    }
 }
 
 void PPU::execute(uint16_t cycles) {
     NES_LOG("PPU") << "Run for " << dec << cycles << " cycles" << endl;
+    synced += Timestamp(cycles) * ppu_dot_ticks;
+    // Batching dots would leave gaps in the trace
+    bool batch = batch_dots && !NES_LOG_ENABLED("PPU");
     while (cycles) {
+        bool rendering = ppumask.bg_show || ppumask.spr_show;
+
+        // Registers are only written between calls, so a visible line run
+        // entirely within this one doesn't need dot accuracy
+        if (scan_x == 0 && scan_y <= 239 && cycles >= ntsc_x && batch) {
+            render_line();
+            cycles -= ntsc_x;
+            continue;
+        }
+
+        const DotInfo &dot = dot_table[line_class(scan_y)][scan_x];
+
+        // Dots that only shift are run at once, e.g. whole VBlank lines
+        uint16_t idle = std::min(dot.idle[rendering], cycles);
+        if (idle && batch) {
+            int from = std::max<int>(scan_x, 2);
+            int to = std::min<int>(scan_x + idle, 338);
+            if (to > from) shift(std::min(to - from, 16));
+            scan_x += idle;
+            cycles -= idle;
+            if (scan_x == ntsc_x) {
+                if (scan_y == ntsc_y - 1) scan_short = !scan_short;
+                scan_y = (scan_y + 1) % ntsc_y;
+                scan_x = 0;
+            }
+            continue;
+        }
+
+        uint16_t act = rendering ? dot.actions : dot.actions & ~act_rendering;
         NES_LOG("PPU") << std::format(
             "X: {:d} Y: {:d} v: {:04X} t: {:04X} w: {:d}\n", scan_x, scan_y,
             (uint16_t)v.addr, (uint16_t)t.addr, w);
-        if (scan_y == 241 && scan_x == 1) {
+        if (act & act_vbl_set) {
             NES_LOG("PPU") << "set vblank" << std::endl;
             ppustatus.vblank = true;
             if (ppuctrl.vbl_nmi && on_nmi_vblank) on_nmi_vblank();
         }
-        if (scan_y <= 240 && scan_x == 0 &&
-            (ppumask.bg_show || ppumask.spr_show)) {
+        if (act & act_bg_addr) {
             bus.addr = (ppuctrl.bg_pt_addr ? 0x1000 : 0x0000) | (nt << 4) |
                        v.sc_fine_y;
         }
 
         // Draw 8 pixels
-        if (scan_y <= 239) {
-            if (scan_x >= 1 && scan_x <= 249) {
-                if (!((scan_x - 1) % 8)) draw();
-            }
-        }
+        if (act & act_draw) draw();
+
+        if (act & act_shift) shift(1);
 
-        if (scan_x >= 2 && scan_x <= 337) {
-            bg_l_shift <<= 1;
-            bg_h_shift <<= 1;
-            at_l_shift <<= 1;
-            at_h_shift <<= 1;
+        // Clear flags
+        if (act & act_flags_clear) {
+            NES_LOG("PPU") << "Clear flags" << endl;
+            ppustatus.vblank = false;
+            ppustatus.spr_overflow = false;
+            ppustatus.spr0_hit = false;
         }
 
-        if (scan_y <= 239 || scan_y == 261) {
-            // Clear flags
-            if (scan_y == 261 && scan_x == 1) {
-                NES_LOG("PPU") << "Clear flags" << endl;
-                ppustatus.vblank = false;
-                ppustatus.spr_overflow = false;
-                ppustatus.spr0_hit = false;
-            }
+        // Sprite logic
+        if (act & act_oam_sec_clear) oam_sec_clear();
+        // Sprite evaluation happens on 65-256, same with fetch. Just batch it
+        // for now, might not be needed to be more correct
+        if (act & act_sprite_eval) {
+            oam_overflow = false;
+            oam_sec_overflow = false;
+            oam_sec_addr = 0x0;
+            sprite_eval();
+        }
+        if (act & act_sprite_fetch) sprite_fetch();
 
-            // Sprite logic
-            if (scan_y <= 239) {
-                if (scan_x >= 1 && scan_x <= 64) oam_sec_clear();
-                if (scan_x == 65) {
-                    oam_overflow = false;
-                    oam_sec_overflow = false;
-                    oam_sec_addr = 0x0;
-                }
-                // Sprite evaluation happens on 65-256, same with fetch. Just
-                // batch it for now, might not be needed to be more correct
-                if (scan_x == 65) sprite_eval();
-                if (scan_x == 257) sprite_fetch();
-            }
+        if (act & act_oamaddr_clear) oamaddr = 0x0;
 
-            // Clear oamaddr
-            if (scan_x >= 257 && scan_x <= 320) oamaddr = 0x0;
-
-            // BG logic
-            switch (scan_x) {
-                // clang-format off
-                // NT
-            case 1:     case 9:     case 17:    case 25:    case 33:
-            case 41:    case 49:    case 57:    case 65:    case 73:
-            case 81:    case 89:    case 97:    case 105:   case 113:
-            case 121:   case 129:   case 137:   case 145:   case 153:
-            case 161:   case 169:   case 177:   case 185:   case 193:
-            case 201:   case 209:   case 217:   case 225:   case 233:
-            case 241:   case 249:   case 257:   case 259:   case 265:
-            case 273:   case 281:   case 289:   case 297:   case 305:
-            case 313:   case 321:   case 329:   case 337:   case 339:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
+        // BG logic
+        switch (rendering ? dot.fetch : fetch_none) {
+            case fetch_none:
+                break;
+            case fetch_nt_addr:
                 bus.addr = 0x2000 | (v.addr & 0x0FFF);
-                NES_LOG("PPU") << "NT addr: 0x" << hex << setfill('0') << setw(4)
-                     << bus.addr << endl;
+                NES_LOG("PPU") << "NT addr: 0x" << hex << setfill('0')
+                               << setw(4) << bus.addr << endl;
                 break;
-                // clang-format off
-            case 2:     case 10:    case 18:    case 26:    case 34:
-            case 42:    case 50:    case 58:    case 66:    case 74:
-            case 82:    case 90:    case 98:    case 106:   case 114:
-            case 122:   case 130:   case 138:   case 146:   case 154:
-            case 162:   case 170:   case 178:   case 186:   case 194:
-            case 202:   case 210:   case 218:   case 226:   case 234:
-            case 242:   case 250:   case 258:   case 260:   case 266:
-            case 274:   case 282:   case 290:   case 298:   case 306:
-            case 314:   case 322:   case 330:   case 338:   case 340:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
+            case fetch_nt:
                 nt = read(bus.addr);
                 NES_LOG("PPU")
                     << "Latch NT@0x" << hex << setfill('0') << setw(4)
                     << bus.addr << ": 0x" << setw(2) << (uint16_t)nt << endl;
                 break;
-                // clang-format off
-
-                // AT
-            case 3:     case 11:    case 19:    case 27:    case 35:
-            case 43:    case 51:    case 59:    case 67:    case 75:
-            case 83:    case 91:    case 99:    case 107:   case 115:
-            case 123:   case 131:   case 139:   case 147:   case 155:
-            case 163:   case 171:   case 179:   case 187:   case 195:
-            case 203:   case 211:   case 219:   case 227:   case 235:
-            case 243:   case 251:   case 323:   case 331:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
-                bus.addr = 0x23C0 | (v.addr & 0x0C00) | ((v.addr >> 4) & 0x38) |
-                           ((v.addr >> 2) & 0x07);
-                NES_LOG("PPU") << "AT addr: 0x" << hex << setfill('0') << setw(4)
-                     << bus.addr << endl;
+            case fetch_at_addr:
+                bus.addr = 0x23C0 | (v.addr & 0x0C00) |
+                           ((v.addr >> 4) & 0x38) | ((v.addr >> 2) & 0x07);
+                NES_LOG("PPU") << "AT addr: 0x" << hex << setfill('0')
+                               << setw(4) << bus.addr << endl;
                 break;
-                // clang-format off
-            case 4:     case 12:    case 20:    case 28:    case 36:
-            case 44:    case 52:    case 60:    case 68:    case 76:
-            case 84:    case 92:    case 100:   case 108:   case 116:
-            case 124:   case 132:   case 140:   case 148:   case 156:
-            case 164:   case 172:   case 180:   case 188:   case 196:
-            case 204:   case 212:   case 220:   case 228:   case 236:
-            case 244:   case 252:   case 324:   case 332:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
+            case fetch_at:
                 at = read(bus.addr);
-                {
-                    uint8_t at_shift = (v.sc_x & 2) | ((v.sc_y & 2) << 1);
-                    uint8_t at_val = (at >> at_shift) & 0x3;
-                    at_latch_l = at_val & 1;
-                    at_latch_h = (at_val >> 1) & 1;
-                }
+                at_latch = (at >> ((v.sc_x & 2) | ((v.sc_y & 2) << 1))) & 0x3;
                 NES_LOG("PPU")
                     << "Latch AT@0x" << hex << setfill('0') << setw(4)
                     << bus.addr << ": 0x" << setw(2) << (uint16_t)at << endl;
                 break;
-                // clang-format off
-                // BG L
-            case 5:     case 13:    case 21:    case 29:    case 37:
-            case 45:    case 53:    case 61:    case 69:    case 77:
-            case 85:    case 93:    case 101:   case 109:   case 117:
-            case 125:   case 133:   case 141:   case 149:   case 157:
-            case 165:   case 173:   case 181:   case 189:   case 197:
-            case 205:   case 213:   case 221:   case 229:   case 237:
-            case 245:   case 253:   case 325:   case 333:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
+            case fetch_bgl_addr:
                 bus.addr = (ppuctrl.bg_pt_addr ? 0x1000 : 0x0000) | (nt << 4) |
                            (v.sc_fine_y);
-                NES_LOG("PPU") << "BGL addr: 0x" << hex << setfill('0') << setw(4)
-                     << bus.addr << endl;
+                NES_LOG("PPU") << "BGL addr: 0x" << hex << setfill('0')
+                               << setw(4) << bus.addr << endl;
                 break;
-                // clang-format off
-            case 6:     case 14:    case 22:    case 30:    case 38:
-            case 46:    case 54:    case 62:    case 70:    case 78:
-            case 86:    case 94:    case 102:   case 110:   case 118:
-            case 126:   case 134:   case 142:   case 150:   case 158:
-            case 166:   case 174:   case 182:   case 190:   case 198:
-            case 206:   case 214:   case 222:   case 230:   case 238:
-            case 246:   case 254:   case 326:   case 334:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
-                bg_latch_l = read(bus.addr);
-
+            case fetch_bgl:
+                bg_latch = chr_plane(bus.addr, 0);
                 NES_LOG("PPU") << "Latch BGL@0x" << hex << setfill('0')
-                               << setw(4) << bus.addr << ", BGL SR = 0x"
-                               << setw(4) << (uint16_t)bg_l_shift << endl;
+                               << setw(4) << bus.addr << ", BG SR = 0x"
+                               << setw(8) << bg_shift << endl;
                 break;
-                // clang-format off
-                // BG H
-            case 7:     case 15:    case 23:    case 31:    case 39:
-            case 47:    case 55:    case 63:    case 71:    case 79:
-            case 87:    case 95:    case 103:   case 111:   case 119:
-            case 127:   case 135:   case 143:   case 151:   case 159:
-            case 167:   case 175:   case 183:   case 191:   case 199:
-            case 207:   case 215:   case 223:   case 231:   case 239:
-            case 247:   case 255:   case 327:   case 335:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
-                bus.addr = ((ppuctrl.bg_pt_addr ? 0x1000 : 0x0000) | (nt << 4) |
-                            (v.sc_fine_y)) +
+            case fetch_bgh_addr:
+                bus.addr = ((ppuctrl.bg_pt_addr ? 0x1000 : 0x0000) |
+                            (nt << 4) | (v.sc_fine_y)) +
                            8;
-                NES_LOG("PPU") << "BGH addr: 0x" << hex << setfill('0') << setw(4)
-                     << bus.addr << endl;
+                NES_LOG("PPU") << "BGH addr: 0x" << hex << setfill('0')
+                               << setw(4) << bus.addr << endl;
                 break;
-                // clang-format off
-            case 8:     case 16:    case 24:    case 32:    case 40:
-            case 48:    case 56:    case 64:    case 72:    case 80:
-            case 88:    case 96:    case 104:   case 112:   case 120:
-            case 128:   case 136:   case 144:   case 152:   case 160:
-            case 168:   case 176:   case 184:   case 192:   case 200:
-            case 208:   case 216:   case 224:   case 232:   case 240:
-            case 248:   case 256:   case 328:   case 336:
-                // clang-format on
-                if (!ppumask.bg_show && !ppumask.spr_show) break;
-
-                bg_latch_h = (uint16_t)read(bus.addr);
-
+            case fetch_bgh:
+                bg_latch = (bg_latch & 0x5555) | chr_plane(bus.addr, 1);
                 NES_LOG("PPU") << "Latch BGH@0x" << hex << setfill('0')
-                               << setw(4) << bus.addr << ", BGH SR = 0x"
-                               << setw(4) << (uint16_t)bg_h_shift << endl;
-
-                bg_l_shift |= bg_latch_l;
-                bg_h_shift |= bg_latch_h;
-                at_l_shift |= at_latch_l ? 0xFF : 0x00;
-                at_h_shift |= at_latch_h ? 0xFF : 0x00;
-
-                if (scan_x == 256) {
-                    inc_vert(v);
-                }
+                               << setw(4) << bus.addr << ", BG SR = 0x"
+                               << setw(8) << bg_shift << endl;
+                reload_shifts();
+                if (act & act_inc_vert) inc_vert(v);
                 inc_hori(v);
-            }
-
-            if (scan_x == 257 && (ppumask.bg_show || ppumask.spr_show)) {
-                set_hori(v, t);
-            }
-
-            if (scan_y == 261 && scan_x >= 280 && scan_x <= 304 &&
-                (ppumask.bg_show || ppumask.spr_show)) {
-                set_vert(v, t);
-            }
+                break;
         }
 
-        if (scan_y == 239 && scan_x == 320) {
-            if (!headless) {
-                uint32_t *fbptr = fb_prim ? fb.data() : fb_sec.data();
-                gui.draw_frame(fbptr);
-            }
-            fb_prim = !fb_prim;
-            frame_count++;
-        }
+        if (act & act_set_hori) set_hori(v, t);
+        if (act & act_set_vert) set_vert(v, t);
+
+        if (act & act_end_frame) end_frame();
 
         if (scan_x == ntsc_x - 2 && scan_y == ntsc_y - 1 && scan_short &&
-            (ppumask.bg_show || ppumask.spr_show)) {
+            rendering) {
             NES_LOG("PPU") << "Odd frame, jump from 339,261 to 0,0" << endl;
             // Jump directly from (339,261) to (0,0) on odd frames
             scan_short = !scan_short;
@@ -520,6 +710,12 @@ void PPU::execute(uint16_t cycles) {
     }
 }
 
+uint32_t PPU::dots_until(uint16_t x, uint16_t y) const {
+    int32_t dots = (int32_t)(y * ntsc_x + x) -
+                   (int32_t)(scan_y * ntsc_x + scan_x);
+    return dots < 0 ? dots + ntsc_x * ntsc_y : dots;
+}
+
 void PPU::cpu_write(uint16_t addr, uint8_t value) {
     NES_LOG("PPU") << std::format("cpu_write@{:04X} value={:02X}\n", addr,
                                   value);
@@ -530,9 +726,14 @@ void PPU::cpu_write(uint16_t addr, uint8_t value) {
         t.nt_h = value & 0x1;
         t.nt_v = (value >> 1) & 0x1;
         break;
-    case 0x2001:  // PPUMASK
+    case 0x2001: {  // PPUMASK
+        bool grayscale = (ppumask.value ^ value) & 0x1;
         ppumask.value = value;
+        if (grayscale) {
+            for (uint8_t idx = 0; idx < pram_sz; idx++) update_pram_color(idx);
+        }
         break;
+    }
     case 0x2002:  // PPUSTATUS read-only
         break;
     case 0x2003:  // OAMADDR
@@ -581,6 +782,15 @@ void PPU::cpu_write(uint16_t addr, uint8_t value) {
     }
 }
 
+void PPU::dma_oam(const uint8_t *data) {
+    NES_LOG("PPU") << std::format("dma_oam oamaddr={:02X}\n", oamaddr);
+    // OAMADDR wraps around and ends up where it started
+    size_t head = oam_sz - oamaddr;
+    memcpy(&oam[oamaddr], data, head);
+    memcpy(&oam[0], data + head, oamaddr);
+    cpu_bus = data[oam_sz - 1];
+}
+
 uint8_t PPU::cpu_read(uint16_t addr, bool passive) {
     NES_LOG("PPU") << std::format("cpu_read@{:04x} passive={}\n", addr,
                                   passive);
@@ -656,79 +866,47 @@ uint8_t PPU::pram_addr(uint16_t addr) {
     return idx;
 }
 
+void PPU::update_pram_color(uint8_t idx) {
+    pram_color[idx] = pram[idx] & (ppumask.grayscale ? Palette::gray_mask
+                                                     : 0x3F);
+}
+
 void PPU::write(uint16_t addr, uint8_t value) {
-    using namespace iNESv1::Mapper;
-    NTMirror mirror = mapper->mirroring();
-    NES_LOG("PPU") << std::format("write {:02X} to {:04X}, mirror: {:d}\n",
-                                  value, addr, (int)mirror);
+    NES_LOG("PPU") << std::format("write {:02X} to {:04X}\n", value, addr);
     switch (addr) {
-    case 0x0000 ... 0x1FFF: mapper->write_ppu(addr, value); break;
-    case 0x2000 ... 0x23FF: vram[addr - 0x2000] = value; break;
-    case 0x2400 ... 0x27FF:
-        switch (mirror) {
-        case map_hori: vram[addr - 0x2000] = value; break;
-        case map_quad: vram[addr - 0x2000] = value; break;
-        case map_vert: vram[addr - 0x2000] = value; break;
-        case map_single: vram[addr - 0x2400] = value; break;
-        }
+    case 0x0000 ... 0x1FFF:
+        mapper->write_ppu(addr, value);
+        chr_valid[addr >> 4] = false;
         break;
-    case 0x2800 ... 0x2BFF:
-        switch (mirror) {
-        case map_hori: vram[addr - 0x2400] = value; break;
-        case map_single: vram[addr - 0x2800] = value; break;
-        case map_vert: vram[addr - 0x2800] = value; break;
-        case map_quad: mapper->write_ppu(addr, value); break;
-        }
+    // $3000-$3EFF mirror $2000-$2EFF
+    case 0x2000 ... 0x3EFF:
+        if (uint8_t *page = nt_page[(addr >> 10) & 0x3])
+            page[addr & 0x3FF] = value;
+        else
+            mapper->write_ppu(addr, value);
         break;
-    case 0x2C00 ... 0x2FFF:
-        switch (mirror) {
-        case map_hori:
-        case map_vert: vram[addr - 0x2800] = value; break;
-        case map_single: vram[addr - 0x2C00] = value; break;
-        case map_quad: mapper->write_ppu(addr, value); break;
-        }
+    case 0x3F00 ... 0x3FFF: {
+        uint8_t idx = pram_addr(addr);
+        pram[idx] = value;
+        update_pram_color(idx);
         break;
-    case 0x3000 ... 0x3EFF: 
-        write(addr-0x1000, value); break;
-    case 0x3F00 ... 0x3FFF: pram[pram_addr(addr)] = value; break;
+    }
     default: throw std::runtime_error("Invalid/unimplemented PPU write");
     }
 }
 
 uint8_t PPU::read(uint16_t addr) {
-    using namespace iNESv1::Mapper;
-    NTMirror mirror = mapper->mirroring();
-    NES_LOG("PPU") << std::format("read@{:04X}, mirror: {:d}\n", addr,
-                                  (int)mirror);
+    NES_LOG("PPU") << std::format("read@{:04X}\n", addr);
     switch (addr) {
-    case 0x0000 ... 0x1FFF: return mapper->read_ppu(addr); break;
-    case 0x2000 ... 0x23FF: return vram[addr - 0x2000]; break;
-    case 0x2400 ... 0x27FF:
-        switch (mirror) {
-        case map_hori: return vram[addr - 0x2000]; break;
-        case map_quad: return vram[addr - 0x2000]; break;
-        case map_vert: return vram[addr - 0x2000]; break;
-        case map_single: return vram[addr - 0x2400]; break;
-        }
-        break;
-    case 0x2800 ... 0x2BFF:
-        switch (mirror) {
-        case map_hori: return vram[addr - 0x2400]; break;
-        case map_single: return vram[addr - 0x2800]; break;
-        case map_vert: return vram[addr - 0x2800]; break;
-        case map_quad: return mapper->read_ppu(addr); break;
-        }
-        break;
-    case 0x2C00 ... 0x2FFF:
-        switch (mirror) {
-        case map_hori:
-        case map_vert: return vram[addr - 0x2800]; break;
-        case map_single: return vram[addr - 0x2C00]; break;
-        case map_quad: return mapper->read_ppu(addr); break;
-        }
-        break;
-    case 0x3000 ... 0x3EFF:
-        return read(addr-0x1000); break;
+    case 0x0000 ... 0x1FFF:
+        if (const uint8_t *page = chr_page[addr >> 10])
+            return page[addr & 0x3FF];
+        return mapper->read_ppu(addr);
+    // $3000-$3EFF mirror $2000-$2EFF
+    case 0x2000 ... 0x3EFF:
+        if (const uint8_t *page = nt_page[(addr >> 10) & 0x3])
+            return page[addr & 0x3FF];
+        return mapper->read_ppu(addr);
     case 0x3F00 ... 0x3FFF: return pram[pram_addr(addr)]; break;
     default: break;
     }
@@ -2,6 +2,7 @@
 #define INC_2A03_PPU_H
 
 #include <bitfield.h>
+#include <clock.h>
 #include <mapper.h>
 #include <palette.h>
 #include <gui.h>
@@ -94,6 +95,7 @@ static const size_t vram_sz = 0x800;    ///< PPU VRAM size
 static const size_t oam_sz = 0x100;     ///< PPU OAM size
 static const size_t oam_sec_sz = 0x20;  ///< Secondary OAM memory size
 static const size_t pram_sz = 0x20;     ///< Palette RAM size
+static const size_t chr_tiles = 0x200;  ///< Tiles in both pattern tables
 
 static const size_t ntsc_x = 341;  ///< NTSC pixel count (341 PPU clock cycles
                                    ///< per scanline)
@@ -115,6 +117,24 @@ class PPU {
     std::array<uint8_t, oam_sz> oam;          ///< PPU OAM
     std::array<uint8_t, oam_sec_sz> oam_sec;  ///< Secondary OAM
     std::array<uint8_t, pram_sz> pram;        ///< Palette RAM
+    /// Color of every palette RAM entry with the PPUMASK grayscale applied,
+    /// updated on palette RAM and PPUMASK writes
+    std::array<uint8_t, pram_sz> pram_color;
+
+    /// Pattern table rows decoded to 8 packed 2-bit pixels, the leftmost in
+    /// the top bits. Indexed by tile * 8 + row, tiles are decoded on first
+    /// use.
+    std::array<uint16_t, chr_tiles * 8> chr_rows;
+    /// Same as `chr_rows`, mirrored horizontally for flipped sprites.
+    std::array<uint16_t, chr_tiles * 8> chr_rows_flip;
+    std::array<bool, chr_tiles> chr_valid;  ///< Tiles decoded in `chr_rows`
+
+    /// Memory of the nametables at $2000, $2400, $2800 and $2C00 as mirrored
+    /// by the cartridge, nullptr for pages the mapper handles
+    std::array<uint8_t *, 4> nt_page{};
+    /// Memory of the 1k pattern table pages, nullptr for pages the mapper
+    /// handles
+    std::array<const uint8_t *, 8> chr_page{};
 
     // Internal PPU registers
     PPUVramAddr v;  ///< 15-bit Current VRAM addr
@@ -130,14 +150,10 @@ class PPU {
 
     uint8_t nt;  // Tile idx for pattern lookup
     uint8_t at;  // Paltete info for a region of tiles (4x4 tiles = 32x32 px)
-    uint8_t at_latch_l;  // AT palette bit L latch
-    uint8_t at_latch_h;  // AT palette bit H latch
-    uint8_t bg_latch_l;  // NT L byte latch
-    uint8_t bg_latch_h;  // NT H byte latch
-    uint16_t bg_l_shift;
-    uint16_t bg_h_shift;
-    uint16_t at_l_shift;  // AT palette L bit shift register
-    uint16_t at_h_shift;  // AT palette H bit shift register
+    uint8_t at_latch;    // AT palette latch, 2 bits
+    uint16_t bg_latch;   // Pattern row latch, 8 packed 2-bit pixels
+    uint32_t bg_shift;   // Pattern shift register, 16 packed 2-bit pixels
+    uint32_t at_shift;   // AT palette shift register, 16 packed 2-bit pixels
 
     uint8_t cpu_bus;
 
@@ -157,21 +173,19 @@ class PPU {
     bool oam_overflow;
     bool oam_sec_overflow;
 
-    /// Sprite output unit latches, loaded during sprite fetch (cycles 257-320)
-    struct SpriteOut {
-        uint8_t pat_l;  ///< Pattern table low byte
-        uint8_t pat_h;  ///< Pattern table high byte
-        uint8_t attr;   ///< Attribute byte (palette, priority, flips)
-        uint8_t x;      ///< X position counter
-    };
-    std::array<SpriteOut, 8> spr_out;
+    /// Sprite pixels of the line, see `Pixel::SpriteBits`. Rendered from the
+    /// sprites loaded during sprite fetch (cycles 257-320).
+    std::array<uint8_t, ntsc_fb_x> spr_line;
     bool spr0_in_range;  ///< Sprite 0 is in secondary OAM this scanline
+    bool spr0_on_line;   ///< `spr_line` has sprite 0 pixels
 
     uint8_t ppudata_buf;  ///< 8-bit PPUADDR read buffer
 
     // Output
-    alignas(16) std::array<uint32_t, ntsc_fb_sz> fb;      ///< Framebuffer
-    alignas(16) std::array<uint32_t, ntsc_fb_sz> fb_sec;  ///< Secondary
+    /// Framebuffer of `Palette::rgba` indices, the emphasis bits above the
+    /// 6-bit color. Converted to RGBA by whoever presents it.
+    alignas(16) std::array<uint16_t, ntsc_fb_sz> fb;
+    alignas(16) std::array<uint16_t, ntsc_fb_sz> fb_sec;  ///< Secondary
     bool fb_prim = true;
 
     std::function<void()> on_nmi_vblank;  ///< Issues a VBlank NMI
@@ -183,17 +197,46 @@ class PPU {
     bool scan_short;      ///< Short scanline (340 ticks instead of 341)
 
     bool headless = false;      ///< Skip GUI rendering for profiling
+    /// Run whole visible lines and idle dots at once when that gives the
+    /// same result. Off runs every dot on its own, the reference the fast
+    /// paths are checked against.
+    bool batch_dots = true;
+    /// Render every Nth frame only, 0 for none. Frames that aren't rendered
+    /// leave the framebuffers alone, everything else, like sprite 0 hits,
+    /// still happens.
+    uint32_t render_interval = 1;
+    bool render_frame = true;   ///< The current frame is rendered
     uint64_t frame_count = 0;   ///< Completed frame counter
+    uint64_t render_count = 0;  ///< Rendered frame counter
+    Timestamp synced = 0;       ///< Master clock time the PPU has run up to
 
     PPU(GFX::GUI &_gui, NES::Palette _pal);
 
     /// Powers up the PPU
     void power();
 
+    /// Sets the cartridge mapper and follows its CHR bank switches.
+    void set_mapper(iNESv1::Mapper::Base *_mapper);
+
+    /// Points `nt_page` and `chr_page` at the memory the mapper maps.
+    void map_pages();
+
     /// Executes the PPU logic.
     /// \value cycles PPU cycles to execute
     void execute(uint16_t cycles);
 
+    /// Runs the PPU up to a master clock timestamp, e.g. the CPU's. Does
+    /// nothing if it's already there.
+    /// \param until Master clock timestamp
+    void sync(Timestamp until);
+
+    /// Returns the number of cycles `execute` runs before reaching the
+    /// provided dot. Doesn't account for the odd frame skip, so the result
+    /// can be 1 too high.
+    /// \param x Pixel
+    /// \param y Scanline
+    uint32_t dots_until(uint16_t x, uint16_t y) const;
+
     /// Writes value @ addr from CPU bus
     void cpu_write(uint16_t addr, uint8_t value);
 
@@ -202,6 +245,39 @@ class PPU {
     /// \param passive Don't trigger additional behaviour, just read
     uint8_t cpu_read(uint16_t addr, bool passive=false);
 
+    /// Copies a page to OAM starting at OAMADDR, the same as 256 writes to
+    /// OAMDATA from OAM DMA.
+    /// \param data Page to copy
+    void dma_oam(const uint8_t *data);
+
+    /// Returns a decoded pattern table row, see `chr_rows`. Decodes the
+    /// tile on a miss, so only the emulation thread may call it.
+    /// \param addr Address of the row's low bitplane byte, $0000-$1FFF with
+    /// bit 3 clear
+    /// \param flip Mirror the row horizontally
+    uint16_t chr_row(uint16_t addr, bool flip = false) {
+        uint16_t tile = addr >> 4;
+        if (!chr_valid[tile]) decode_tile(tile);
+        return (flip ? chr_rows_flip : chr_rows)[tile * 8 + (addr & 0x7)];
+    }
+
+    /// Drops the decoded tiles of a pattern table range, e.g. after a CHR
+    /// bank switch.
+    /// \param addr First address of the range
+    /// \param size Size of the range in bytes
+    void invalidate_chr(uint16_t addr, uint16_t size);
+
+    /// Returns a row of 8 packed 2-bit pixels from its two bitplanes, see
+    /// `chr_rows`.
+    /// \param flip Mirror the row horizontally
+    static uint16_t decode_row(uint8_t pat_l, uint8_t pat_h, bool flip);
+
+    /// Returns a bitplane of a register of packed 2-bit pixels, the way the
+    /// hardware keeps it.
+    /// \param packed Register, e.g. `bg_shift`
+    /// \param plane 0 for the low bitplane, 1 for the high one
+    static uint16_t bitplane(uint32_t packed, int plane);
+
    protected:
     /// Write value to addr
     void write(uint16_t addr, uint8_t value);
@@ -212,6 +288,36 @@ class PPU {
     /// Draws a pixel for the current cycle
     void draw();
 
+    /// Runs dots 0-340 of a visible scanline at once. Produces the same state
+    /// as running them one by one, as long as no register is written in
+    /// between.
+    void render_line();
+
+    /// Does the 8 background fetches of a tile: nametable, attribute and the
+    /// two pattern bytes, leaving the results in the latches.
+    void fetch_tile();
+
+    /// Shifts the background shift registers.
+    /// \param dots Dots to shift for, at most 16
+    void shift(uint8_t dots);
+
+    /// Loads the latches into the low 8 pixels of the background shift
+    /// registers.
+    void reload_shifts();
+
+    /// Presents the finished frame and flips the framebuffers.
+    void end_frame();
+
+    /// Decodes a tile into `chr_rows` and `chr_rows_flip`.
+    void decode_tile(uint16_t tile);
+
+    /// Returns the byte at a PPU address as a bitplane of 8 packed 2-bit
+    /// pixels, the other bits clear. Pattern table bytes come from the tile
+    /// cache.
+    /// \param addr Address of the byte, usually a pattern table one
+    /// \param plane 0 for the low bitplane, 1 for the high one
+    uint16_t chr_plane(uint16_t addr, int plane);
+
     // Sprite-related logic
     void oam_sec_clear();
     void sprite_eval();
@@ -219,6 +325,8 @@ class PPU {
 
     // Pram address mapping
     uint8_t pram_addr(uint16_t addr);
+    /// Updates `pram_color` for a palette RAM entry.
+    void update_pram_color(uint8_t idx);
 };
 
 }  // namespace NES
@@ -0,0 +1,229 @@
+#include <ines.h>
+#include <opcodes.h>
+#include <profiler.h>
+
+#include <json.hpp>
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+namespace NES {
+
+using iNESv1::prg_rom_page_sz;
+
+namespace {
+/// Names of `AddressingMode` values.
+const char *const mode_names[] = {"rel",       "abs",       "abs_x", "abs_y",
+                                  "imm",       "zp",        "zp_x",  "zp_y",
+                                  "idx_ind_x", "ind_idx_y", "ind",   "acc",
+                                  "impl"};
+const int mode_count = sizeof(mode_names) / sizeof(mode_names[0]);
+static_assert(mode_count == impl + 1);
+
+/// Names of `Profiler::Region` values.
+const char *const region_names[] = {"ram", "ppu", "io", "prg_ram", "prg_rom"};
+static_assert(sizeof(region_names) / sizeof(region_names[0]) ==
+              Profiler::reg_count);
+}  // namespace
+
+void Profiler::call(uint32_t site, uint32_t target, uint8_t sp,
+                    uint64_t now) {
+    // The stack grows down, calls at or below this one never returned
+    while (!stack.empty() && stack.back().sp <= sp) {
+        finish(stack.back(), now);
+        stack.pop_back();
+    }
+    entries.insert(target);
+    calls[{site, target}].count++;
+    stack.push_back({site, target, sp, now, total.count});
+}
+
+void Profiler::ret(uint8_t sp, uint64_t now) {
+    // Calls below the stack pointer had their return address dropped
+    while (!stack.empty() && stack.back().sp < sp) {
+        finish(stack.back(), now);
+        stack.pop_back();
+    }
+    if (!stack.empty() && stack.back().sp == sp) {
+        finish(stack.back(), now);
+        stack.pop_back();
+    }
+}
+
+void Profiler::clear() {
+    locations.clear();
+    total = {};
+    stack.clear();
+    calls.clear();
+    entries.clear();
+    ops.fill({});
+    idle_cycles = 0;
+    dummy_reads = 0;
+    accesses.fill({});
+}
+
+void Profiler::grow(uint32_t loc) {
+    // Grow in PRG ROM bank steps, there are only a few
+    locations.resize((loc / prg_rom_page_sz + 1) * prg_rom_page_sz);
+}
+
+void Profiler::finish(const Frame &frame, uint64_t now) {
+    Calls &c = calls[{frame.site, frame.target}];
+    c.cycles += now - frame.start;
+    c.instructions += total.count - frame.count;
+}
+
+uint32_t Profiler::function(uint32_t loc) const {
+    uint32_t region = loc < rom_base ? 0x0 : rom_base;
+    auto it = entries.upper_bound(loc);
+    if (it == entries.begin() || *std::prev(it) < region) return region;
+    return *std::prev(it);
+}
+
+uint16_t Profiler::pc(uint32_t loc) const {
+    if (loc < rom_base) return loc;
+    return loc < locations.size() ? locations[loc].pc : 0x0;
+}
+
+std::string Profiler::name(uint32_t loc) const {
+    if (loc < rom_base) return std::format("${:04X}", loc);
+    return std::format("{:02X}:${:04X}", (loc - rom_base) / prg_rom_page_sz,
+                       pc(loc));
+}
+
+void Profiler::write_callgrind(std::ostream &os,
+                               const std::string &cmd) const {
+    // Files are the RAM and the PRG ROM banks
+    auto file = [](uint32_t loc) {
+        return loc < rom_base ? std::string("RAM")
+                              : std::format("PRG bank {:02X}",
+                                            (loc - rom_base) / prg_rom_page_sz);
+    };
+
+    os << "# callgrind format\n"
+       << "version: 1\n"
+       << "creator: 2a03\n"
+       << "cmd: " << cmd << "\n"
+       << "positions: instr\n"
+       << "events: Cycles Instructions\n"
+       << "summary: " << total.cycles << " " << total.count << "\n";
+
+    uint32_t fn = UINT32_MAX;
+    auto enter = [&](uint32_t loc) {
+        uint32_t f = function(loc);
+        if (f == fn) return;
+        fn = f;
+        os << "\nfl=" << file(f) << "\nfn=" << name(f) << "\n";
+    };
+
+    // Costs are emitted in location order, call sites are part of it
+    auto site = calls.begin();
+    for (uint32_t loc = 0; loc < locations.size(); loc++) {
+        const Location &l = locations[loc];
+        if (l.self.count || l.self.cycles) {
+            enter(loc);
+            os << std::format("0x{:04X} {} {}\n", l.pc, l.self.cycles,
+                              l.self.count);
+        }
+        for (; site != calls.end() && site->first.first == loc; site++) {
+            uint32_t target = site->first.second;
+            const Calls &c = site->second;
+            enter(loc);
+            os << "cfl=" << file(target) << "\ncfn=" << name(target) << "\n"
+               << std::format("calls={} 0x{:04X}\n", c.count, pc(target))
+               << std::format("0x{:04X} {} {}\n", l.pc, c.cycles,
+                              c.instructions);
+        }
+    }
+}
+
+void Profiler::write_csv(std::ostream &os) const {
+    os << "location,bank,pc,function,opcode,mnemonic,count,cycles\n";
+    for (uint32_t loc = 0; loc < locations.size(); loc++) {
+        const Location &l = locations[loc];
+        if (!l.self.count && !l.self.cycles) continue;
+        std::string bank =
+            loc < rom_base ? ""
+                           : std::to_string((loc - rom_base) / prg_rom_page_sz);
+        os << std::format("{:05X},{},{:04X},{},{:02X},{},{},{}\n", loc, bank,
+                          l.pc, name(function(loc)), l.opcode,
+                          op_info[l.opcode].mnemonic, l.self.count,
+                          l.self.cycles);
+    }
+}
+
+void Profiler::print_stats(std::ostream &os) const {
+    os << std::format(
+        "Executed {} instructions in {} cycles, {} skipped in idle loops, {} "
+        "dummy reads\n",
+        total.count, total.cycles, idle_cycles, dummy_reads);
+
+    std::vector<int> by_cycles;
+    for (int op = 0; op < 256; op++)
+        if (ops[op].cost.count) by_cycles.push_back(op);
+    std::sort(by_cycles.begin(), by_cycles.end(), [&](int a, int b) {
+        return ops[a].cost.cycles > ops[b].cost.cycles;
+    });
+    os << std::format("\n{:7} {:10} {:>12} {:>13} {:>8} {:>8} {:>10} {:>10}\n",
+                      "Opcode", "Mode", "Count", "Cycles", "Cycles%", "Page+",
+                      "Taken", "Not taken");
+    for (int op : by_cycles) {
+        const OpStats &o = ops[op];
+        os << std::format(
+            "{:02X} {:4} {:10} {:12} {:13} {:7.2f}% {:8} {:10} {:10}\n", op,
+            op_info[op].mnemonic, mode_names[op_info[op].mode], o.cost.count,
+            o.cost.cycles, 100.0 * o.cost.cycles / total.cycles,
+            o.page_crossings, o.taken, o.not_taken);
+    }
+
+    std::array<Cost, mode_count> modes{};
+    for (int op = 0; op < 256; op++) {
+        modes[op_info[op].mode].count += ops[op].cost.count;
+        modes[op_info[op].mode].cycles += ops[op].cost.cycles;
+    }
+    os << std::format("\n{:10} {:>12} {:>13}\n", "Mode", "Count", "Cycles");
+    for (int m = 0; m < mode_count; m++)
+        if (modes[m].count)
+            os << std::format("{:10} {:12} {:13}\n", mode_names[m],
+                              modes[m].count, modes[m].cycles);
+
+    os << std::format("\n{:10} {:>12} {:>12}\n", "Region", "Reads", "Writes");
+    for (int r = 0; r < reg_count; r++)
+        os << std::format("{:10} {:12} {:12}\n", region_names[r],
+                          accesses[r].reads, accesses[r].writes);
+}
+
+void Profiler::write_stats_json(std::ostream &os) const {
+    nlohmann::json j;
+    j["instructions"] = total.count;
+    j["cycles"] = total.cycles;
+    j["idle_cycles"] = idle_cycles;
+    j["dummy_reads"] = dummy_reads;
+
+    j["opcodes"] = nlohmann::json::array();
+    std::array<Cost, mode_count> modes{};
+    for (int op = 0; op < 256; op++) {
+        const OpStats &o = ops[op];
+        modes[op_info[op].mode].count += o.cost.count;
+        modes[op_info[op].mode].cycles += o.cost.cycles;
+        if (!o.cost.count) continue;
+        j["opcodes"].push_back({{"opcode", op},
+                                {"mnemonic", op_info[op].mnemonic},
+                                {"mode", mode_names[op_info[op].mode]},
+                                {"count", o.cost.count},
+                                {"cycles", o.cost.cycles},
+                                {"page_crossings", o.page_crossings},
+                                {"taken", o.taken},
+                                {"not_taken", o.not_taken}});
+    }
+    for (int m = 0; m < mode_count; m++)
+        j["modes"][mode_names[m]] = {{"count", modes[m].count},
+                                     {"cycles", modes[m].cycles}};
+    for (int r = 0; r < reg_count; r++)
+        j["regions"][region_names[r]] = {{"reads", accesses[r].reads},
+                                         {"writes", accesses[r].writes}};
+    os << j.dump(2) << "\n";
+}
+
+}  // namespace NES
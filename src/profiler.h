@@ -0,0 +1,213 @@
+#ifndef INC_2A03_PROFILER_H
+#define INC_2A03_PROFILER_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace NES {
+
+#ifdef NES_ENABLE_PROFILER
+/// Evaluates a profiler call, removed entirely unless the profiler is enabled.
+#define NES_PROFILE(stmt) stmt
+#else
+#define NES_PROFILE(stmt)
+#endif
+
+/// Guest code profiler. Attributes CPU cycles to the location of the
+/// instruction they were spent on and infers a call graph from JSR/RTS and
+/// interrupts/RTI. Also keeps execution statistics: per opcode counts,
+/// penalty cycles and branch outcomes, dummy reads and bus accesses per
+/// region. Collection is compiled in with `ENABLE_PROFILER`.
+///
+/// Locations tell apart code mapped from different PRG ROM banks: addresses
+/// below $8000 are their own location, PRG ROM code is located by its ROM
+/// offset from `rom_base` on.
+class Profiler {
+   public:
+    /// First location of PRG ROM code.
+    static const uint32_t rom_base = 0x10000;
+
+    /// Executed instructions and the cycles spent on them.
+    struct Cost {
+        uint64_t count = 0;
+        uint64_t cycles = 0;
+    };
+
+    /// Region of the CPU address space.
+    enum Region {
+        reg_ram,      ///< Internal RAM and mirrors, $0000-$1FFF.
+        reg_ppu,      ///< PPU registers and mirrors, $2000-$3FFF.
+        reg_io,       ///< APU, I/O and expansion, $4000-$5FFF.
+        reg_prg_ram,  ///< PRG RAM, $6000-$7FFF.
+        reg_prg_rom,  ///< PRG ROM, $8000-$FFFF.
+        reg_count
+    };
+
+    /// Statistics of an opcode.
+    struct OpStats {
+        Cost cost;                    ///< Executions and cycles.
+        uint64_t page_crossings = 0;  ///< Page crossing penalty cycles.
+        uint64_t taken = 0;           ///< Branches taken.
+        uint64_t not_taken = 0;       ///< Branches not taken.
+    };
+
+    /// Bus accesses to a region.
+    struct Accesses {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+    };
+
+    /// Records an executed instruction.
+    /// \param loc Location of the instruction.
+    /// \param pc Address the instruction was executed at.
+    /// \param opcode Opcode of the instruction.
+    /// \param cycles Cycles spent, including DMA and interrupt entry that
+    /// followed it.
+    void instruction(uint32_t loc, uint16_t pc, uint8_t opcode,
+                     uint64_t cycles) {
+        if (loc >= locations.size()) grow(loc);
+        Location &l = locations[loc];
+        l.self.count++;
+        l.self.cycles += cycles;
+        l.pc = pc;
+        l.opcode = opcode;
+        total.count++;
+        total.cycles += cycles;
+        ops[opcode].cost.count++;
+        ops[opcode].cost.cycles += cycles;
+    }
+
+    /// Records a cycle added for crossing a page, by indexing or a branch.
+    void page_crossing(uint8_t opcode) { ops[opcode].page_crossings++; }
+
+    /// Records the outcome of a branch.
+    void branch(uint8_t opcode, bool taken) {
+        if (taken)
+            ops[opcode].taken++;
+        else
+            ops[opcode].not_taken++;
+    }
+
+    /// Records a read whose value is discarded.
+    void dummy_read() { dummy_reads++; }
+
+    /// Records a bus access, including instruction fetches served from the
+    /// decoded instruction cache.
+    void access(uint16_t addr, bool write) {
+        Accesses &a = accesses[region(addr)];
+        if (write)
+            a.writes++;
+        else
+            a.reads++;
+    }
+
+    /// Returns the region of an address.
+    static Region region(uint16_t addr) {
+        return addr < 0x8000 ? Region(addr >> 13) : reg_prg_rom;
+    }
+
+    /// Records cycles skipped by fast-forwarding through an idle loop.
+    /// \param loc Location of the loop's last instruction.
+    void idle(uint32_t loc, uint64_t cycles) {
+        if (loc >= locations.size()) grow(loc);
+        locations[loc].self.cycles += cycles;
+        total.cycles += cycles;
+        idle_cycles += cycles;
+    }
+
+    /// Records a function entry which isn't called, e.g. the reset handler.
+    void entry(uint32_t loc) { entries.insert(loc); }
+
+    /// Records a subroutine call or interrupt.
+    /// \param site Location of the calling (or interrupted) instruction.
+    /// \param target Location of the first instruction called.
+    /// \param sp Stack pointer after the return address was pushed.
+    /// \param now Cycle the callee starts at.
+    void call(uint32_t site, uint32_t target, uint8_t sp, uint64_t now);
+
+    /// Records a return from a subroutine or interrupt. Returns without a
+    /// matching call, e.g. RTS used as a jump, are ignored.
+    /// \param sp Stack pointer before the return address is pulled.
+    /// \param now Cycle the caller resumes at.
+    void ret(uint8_t sp, uint64_t now);
+
+    /// Discards everything collected so far.
+    void clear();
+
+    /// Writes a Callgrind profile, functions start at call targets.
+    /// \param os Output stream.
+    /// \param cmd Command shown by the viewer, e.g. the ROM name.
+    void write_callgrind(std::ostream &os, const std::string &cmd) const;
+
+    /// Writes a CSV file with a row per location.
+    void write_csv(std::ostream &os) const;
+
+    /// Prints the execution statistics in a human readable form.
+    void print_stats(std::ostream &os) const;
+
+    /// Writes the execution statistics as JSON.
+    void write_stats_json(std::ostream &os) const;
+
+   private:
+    /// Profile of a location.
+    struct Location {
+        Cost self;           ///< Cost of the instruction there.
+        uint16_t pc = 0x0;   ///< Address it was last executed at.
+        uint8_t opcode = 0;  ///< Opcode last executed there.
+    };
+
+    /// Calls from a call site to a target.
+    struct Calls {
+        uint64_t count = 0;         ///< Calls made.
+        uint64_t cycles = 0;        ///< Inclusive cycles of the callee.
+        uint64_t instructions = 0;  ///< Inclusive instructions.
+    };
+
+    /// Call in progress.
+    struct Frame {
+        uint32_t site;    ///< Location of the calling instruction.
+        uint32_t target;  ///< Location called.
+        uint8_t sp;       ///< Stack pointer after the call.
+        uint64_t start;   ///< Cycle the callee started at.
+        uint64_t count;   ///< `total.count` when the call happened.
+    };
+
+    std::vector<Location> locations;  ///< Indexed by location.
+    Cost total;                       ///< Sum of all recorded costs.
+    std::vector<Frame> stack;         ///< Calls in progress.
+    /// Calls made, keyed on call site and target.
+    std::map<std::pair<uint32_t, uint32_t>, Calls> calls;
+    std::set<uint32_t> entries;       ///< Function entry locations.
+    std::array<OpStats, 256> ops{};   ///< Indexed by opcode.
+    uint64_t idle_cycles = 0;         ///< Cycles skipped in idle loops.
+    uint64_t dummy_reads = 0;         ///< Reads whose value is discarded.
+    /// Bus accesses, indexed by `Region`.
+    std::array<Accesses, reg_count> accesses{};
+
+    /// Makes `loc` a valid index into `locations`.
+    void grow(uint32_t loc);
+
+    /// Adds the cost of a finished call to `calls`.
+    void finish(const Frame &frame, uint64_t now);
+
+    /// Returns the entry of the function containing the location. Functions
+    /// span from an entry to the next one in the same region, code before
+    /// the first entry belongs to the region start.
+    uint32_t function(uint32_t loc) const;
+
+    /// Returns the address the location was executed at.
+    uint16_t pc(uint32_t loc) const;
+
+    /// Returns the name of the location, with the bank for PRG ROM.
+    std::string name(uint32_t loc) const;
+};
+
+}  // namespace NES
+
+#endif  // INC_2A03_PROFILER_H
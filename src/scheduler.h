@@ -0,0 +1,72 @@
+#ifndef INC_2A03_SCHEDULER_H
+#define INC_2A03_SCHEDULER_H
+
+#include <clock.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace NES {
+
+/// Upcoming CPU events keyed on the master clock timestamp they are due at.
+/// There are only a few event types with at most one instance each, so the
+/// queue is a timestamp per type plus the cached earliest one. The CPU
+/// compares its timestamp against `next` once per instruction and only looks
+/// at the individual events when one is due.
+class Scheduler {
+   public:
+    /// Timestamp of events which aren't scheduled.
+    static constexpr Timestamp never = std::numeric_limits<Timestamp>::max();
+
+    /// Event type.
+    enum Event {
+        ev_nmi,  ///< NMI line asserted, e.g. by the PPU on vblank.
+        ev_irq,  ///< IRQ line asserted, e.g. by the APU frame counter or a
+                 ///< mapper. Stays due until cancelled.
+        ev_dma,  ///< DMA transfer start.
+        ev_count
+    };
+
+    Scheduler() { clear(); }
+
+    /// Schedules an event, replacing a previous instance of it.
+    /// \param event Event type.
+    /// \param at Master clock timestamp the event is due at.
+    void schedule(Event event, Timestamp at) {
+        due[event] = at;
+        next_due = *std::min_element(due.begin(), due.end());
+    }
+
+    /// Removes a scheduled event.
+    void cancel(Event event) {
+        due[event] = never;
+        next_due = *std::min_element(due.begin(), due.end());
+    }
+
+    /// Removes all events.
+    void clear() {
+        due.fill(never);
+        next_due = never;
+    }
+
+    /// Returns `true` if the event is due at the provided timestamp.
+    bool pending(Event event, Timestamp now) const {
+        return due[event] <= now;
+    }
+
+    /// Returns `true` if the event is scheduled at all.
+    bool scheduled(Event event) const { return due[event] != never; }
+
+    /// Returns the timestamp of the earliest event.
+    Timestamp next() const { return next_due; }
+
+   private:
+    std::array<Timestamp, ev_count> due;  ///< Timestamp of every event type.
+    Timestamp next_due;                   ///< Earliest timestamp in `due`.
+};
+
+}  // namespace NES
+
+#endif  // INC_2A03_SCHEDULER_H
@@ -16,7 +16,7 @@ struct BusAccess {
     bool read; 
 };
 
-class MemoryBus : public MemoryBusIntf {
+class MemoryBus final : public MemoryBusIntf {
 public:
     static const int ram_size = 65536;
     std::array<uint8_t, ram_size> ram{};
@@ -41,6 +41,16 @@ public:
         ram[addr] = val;
     }
 
+    /// Reads are recorded, so none of them can be skipped.
+    uint8_t stable_bits(uint16_t addr) const {
+        return 0x0;
+    }
+
+    /// DMA always goes through `read` and `write` to be recorded.
+    bool dma_oam(uint8_t page) {
+        return false;
+    }
+
     void mock_clear_ops() {
         ops.clear();
     }
@@ -2,6 +2,7 @@
 #define INC_2A03_TEST_CPU_H
 
 #include <json.hpp>
+#include <opcodes.h>
 #include <iostream>
 #include <fstream>
 #include <format>
@@ -116,7 +117,8 @@ void print_actual_state(NES::ExecutionEnvironment &ee,
     os << std::format(
         "Actual CPU: PC=0x{:04X} S=0x{:02X} A=0x{:02X} "
         "X=0x{:02X} Y={:02X} P={:02X}\n",
-        ee.cpu.PC, ee.cpu.S, ee.cpu.A, ee.cpu.X, ee.cpu.Y, ee.cpu.P.status);
+        ee.cpu.PC, ee.cpu.S, ee.cpu.A, ee.cpu.X, ee.cpu.Y,
+        ee.cpu.status().status);
 
     os << "Actual RAM:" << std::endl;
     for (const auto &ram : tc.final.ram) {
@@ -161,7 +163,7 @@ bool assert_final_state(NES::ExecutionEnvironment &ee,
     ASSERT_EQUAL(ee.cpu.A, tc.final.a);
     ASSERT_EQUAL(ee.cpu.X, tc.final.x);
     ASSERT_EQUAL(ee.cpu.Y, tc.final.y);
-    ASSERT_EQUAL(ee.cpu.P.status, tc.final.p);
+    ASSERT_EQUAL(ee.cpu.status().status, tc.final.p);
 
     for (const auto &ram : tc.final.ram) {
         uint8_t actual_value = bus->mock_read((uint16_t)ram.address);
@@ -178,20 +180,43 @@ bool assert_final_state(NES::ExecutionEnvironment &ee,
     return true;
 }
 
-void cpu(ExecutionEnvironment &ee, NES::Test::MemoryBus *bus) {
+/// Runs the test case through the JIT entry of the opcode and checks the
+/// final state, cycle count and every access in order. The opcode and its
+/// operand come from the predecoded instruction rather than the bus, so the
+/// reads fetching them are left out of the expected accesses.
+bool run_jit(ExecutionEnvironment &ee, NES::Test::MemoryBus *bus,
+             const TestCase &run) {
+    dynamic_cast<CPUCore<Test::MemoryBus> &>(ee.cpu).execute_jit_op();
+
+    // The first access fetches the opcode
+    TestCase tc = run;
+    uint8_t len = op_info[run.cycles.front().value].len;
+    tc.cycles.erase(tc.cycles.begin(), tc.cycles.begin() + len);
+
+    if (!assert_final_state(ee, bus, tc)) return false;
+    ASSERT_EQUAL(ee.cpu.cycles, run.cycles.size());
+    return true;
+}
+
+/// Runs the nes6502 single step tests.
+/// \param jit Run every instruction through its JIT entry instead of the
+/// interpreter.
+void cpu(ExecutionEnvironment &ee, NES::Test::MemoryBus *bus,
+         bool jit = false) {
     ee.disable_ppu = true;
     ee.run_single_step = true;
     ee.gui.mapper = nullptr;
     ee.cpu.test_mode = true;
 
     for (uint16_t i = 0x00; i <= 0xff; i++) {
-        if (i == 0x93 || i == 0x9b || i == 0x9c || i == 0x9e || i == 0x9f
-            || i == 0xbb || i == 0xcb) {
+        if (op_info[i].unstable) {
             std::cerr << "Disabled tests for 0x" << std::hex 
-                      << (unsigned int)i 
-                      << ". Unstable ops with weird behaviour" << std::endl;
+                      << (unsigned int)i << " (" << op_info[i].mnemonic
+                      << "). Unstable ops with weird behaviour" << std::endl;
             continue;
         }
+        // The JIT leaves JAM to the interpreter
+        if (jit && std::string(op_info[i].mnemonic) == "JAM") continue;
 
         std::string filename = get_testspec_name(i);
         std::cout << "Executing " << filename << ". "; 
@@ -216,7 +241,7 @@ void cpu(ExecutionEnvironment &ee, NES::Test::MemoryBus *bus) {
                     cpu.X = tc.initial.x;
                     cpu.Y = tc.initial.y;
                     cpu.S = tc.initial.s;
-                    cpu.P.status = tc.initial.p;
+                    cpu.set_status(tc.initial.p);
                     cpu.cycles = 0;
                 });
                 bus->mock_clear_ops();
@@ -226,8 +251,14 @@ void cpu(ExecutionEnvironment &ee, NES::Test::MemoryBus *bus) {
                 for (const auto &ram : tc.initial.ram) {
                     bus->mock_write(ram.address, ram.value);
                 }
-                ee.run();
-                if (!assert_final_state(ee, bus, tc)) {
+                bool passed;
+                if (jit) {
+                    passed = run_jit(ee, bus, tc);
+                } else {
+                    ee.run();
+                    passed = assert_final_state(ee, bus, tc);
+                }
+                if (!passed) {
                     i = 0x101;
                     break;
                 }
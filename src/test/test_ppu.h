@@ -1,8 +1,15 @@
 #ifndef INC_2A03_TEST_PPU_H
 #define INC_2A03_TEST_PPU_H
 
+#include <pixel.h>
+
+#include <chrono>
+#include <format>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
 namespace NES {
 
@@ -14,6 +21,10 @@ const std::string color_test = "color_test.nes";
 const std::string palette_ram = "palette_ram.nes";
 const std::string test_ppu_read_buffer = "test_ppu_read_buffer.nes";
 const std::string vbl_clear_time = "vbl_clear_time.nes";
+/// Pattern tables the PPU fast paths are checked with
+const std::string fast_path_rom = "nestest.nes";
+/// Polls PPUSTATUS for vblank, checks catching the PPU up on demand
+const std::string sync_rom = "01-basics.nes";
 
 void ppu(ExecutionEnvironment &ee) {
     using namespace NES::iNESv1;
@@ -35,6 +46,282 @@ void ppu(ExecutionEnvironment &ee) {
     ee.run();
 }
 
+/// Checks that every pixel kernel the CPU supports matches the scalar one on
+/// random input, and times them.
+void pixel_kernels(const Palette &pal) {
+    const int inputs = 4096;
+    const int rounds = 2000;
+    using clock = std::chrono::steady_clock;
+    using ns = std::chrono::duration<double, std::nano>;
+
+    std::mt19937 rng(2);
+    std::vector<uint8_t> spr(inputs * 8);
+    std::vector<uint8_t> colors(inputs * 32);
+    std::vector<Pixel::Input> in(inputs);
+    for (auto &b : spr) b = rng() % 2 ? rng() & 0x3F : 0x0;
+    for (auto &c : colors) c = rng() & 0x3F;
+    for (int i = 0; i < inputs; i++) {
+        in[i].bg = rng();
+        in[i].at = rng();
+        in[i].bg_show = rng() % 4;
+        in[i].spr = &spr[i * 8];
+        in[i].colors = &colors[i * 32];
+        in[i].emphasis = (rng() & 0x7) << 6;
+    }
+
+    std::vector<uint16_t> ref(inputs * 8), out(inputs * 8);
+    std::vector<uint32_t> ref_rgba(inputs * 8), rgba(inputs * 8);
+    std::vector<uint8_t> ref_hits(inputs);
+    double ref_compose = 0.0, ref_convert = 0.0;
+    for (auto &impl : Pixel::implementations()) {
+        std::vector<uint8_t> hits(inputs);
+        auto start = clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (int i = 0; i < inputs; i++)
+                hits[i] = impl.compose(in[i], &out[i * 8]);
+        double compose = ns(clock::now() - start).count() / rounds / inputs;
+
+        start = clock::now();
+        for (int r = 0; r < rounds; r++)
+            impl.to_rgba(out.data(), out.size(), pal.rgba.data(),
+                         rgba.data());
+        double convert = ns(clock::now() - start).count() / rounds / inputs;
+
+        if (ref_compose == 0.0) {
+            ref = out;
+            ref_rgba = rgba;
+            ref_hits = hits;
+            ref_compose = compose;
+            ref_convert = convert;
+        }
+        bool same = out == ref && hits == ref_hits && rgba == ref_rgba;
+        std::cout << std::format(
+            "{:8} compose {:6.2f} ns, {:5.2f}x, to RGBA {:6.2f} ns, {:5.2f}x "
+            "per 8 pixels, {}\n",
+            impl.name, compose, ref_compose / compose, convert,
+            ref_convert / convert, same ? "matches scalar" : "MISMATCH");
+    }
+}
+
+/// Returns the first part of the PPU state the CPU or the screen can observe
+/// which differs, or an empty string.
+/// \param fb Compare the framebuffers too
+std::string ppu_diff(const PPU &a, const PPU &b, bool fb) {
+    if (a.scan_x != b.scan_x || a.scan_y != b.scan_y) return "position";
+    if (a.frame_count != b.frame_count) return "frame_count";
+    if (a.v.addr != b.v.addr || a.t.addr != b.t.addr ||
+        a.x.fine != b.x.fine || a.w != b.w)
+        return "v/t";
+    if (a.ppustatus.value != b.ppustatus.value) return "ppustatus";
+    if (a.oam != b.oam || a.oamaddr != b.oamaddr) return "oam";
+    if (a.ppudata_buf != b.ppudata_buf) return "ppudata_buf";
+    if (fb && (a.fb != b.fb || a.fb_sec != b.fb_sec)) return "fb";
+    return "";
+}
+
+/// Drives three PPUs with the same random register traffic: one dot by dot,
+/// one taking the fast paths and one rendering no frames. Checks that they
+/// stay in the same state, but for the framebuffers of the last one, and
+/// that the decoded tiles match the pattern tables.
+/// \param seed Random traffic seed
+/// \param frames Frames to run
+/// \return `true` if everything matched
+bool ppu_fast_paths(GFX::GUI &gui, const Palette &pal, unsigned seed,
+                    uint64_t frames) {
+    std::mt19937 rng(seed);
+    auto rnd = [&](int n) { return int(rng() % n); };
+
+    std::string rom = fast_path_rom;
+    iNESv1::Cartridge cart = iNESv1::load(rom);
+    // Random patterns with transparent pixels make for more sprite 0 hits
+    for (auto &b : cart.chr_rom) b = rnd(4) ? rng() : 0x0;
+    std::unique_ptr<iNESv1::Mapper::Base> mapper(
+        iNESv1::Mapper::mapper(cart));
+
+    std::array<std::unique_ptr<PPU>, 3> ppus;
+    for (auto &ppu : ppus) {
+        ppu = std::make_unique<PPU>(gui, pal);
+        ppu->headless = true;
+        ppu->set_mapper(mapper.get());
+    }
+    PPU &ref = *ppus[0];
+    ref.batch_dots = false;
+    ppus[2]->render_interval = 0;
+    for (auto &ppu : ppus) ppu->power();
+
+    std::vector<uint8_t> vram(vram_sz), oam(oam_sz);
+    for (auto &b : vram) b = rng();
+    for (size_t i = 0; i < oam_sz; i++)
+        oam[i] = i % 4 || rnd(8) ? rng() : 0xF0 + rnd(16);
+    // Crowd a line now and then for sprite overflow
+    for (int i = 0; i < 12; i++) oam[rnd(64) * 4] = 100;
+    for (auto &ppu : ppus) {
+        std::copy(vram.begin(), vram.end(), ppu->vram.begin());
+        std::copy(oam.begin(), oam.end(), ppu->oam.begin());
+    }
+
+    std::string diff;
+    // Runs an access on every PPU, accesses past $3FFF throw on all alike
+    auto each = [&](auto access) {
+        std::array<int, 3> results;
+        for (size_t i = 0; i < ppus.size(); i++) {
+            try {
+                results[i] = access(*ppus[i]);
+            } catch (std::runtime_error &) {
+                results[i] = -1;
+            }
+        }
+        return results[0] == results[1] && results[0] == results[2];
+    };
+    auto write = [&](uint16_t addr, uint8_t value) {
+        if (!each([&](PPU &ppu) {
+                ppu.cpu_write(addr, value);
+                return 0;
+            }))
+            diff = std::format("write @{:04X}", addr);
+    };
+    auto read = [&](uint16_t addr) {
+        if (!each([&](PPU &ppu) { return int(ppu.cpu_read(addr)); }))
+            diff = std::format("read @{:04X}", addr);
+    };
+    for (uint8_t i = 0; i < pram_sz; i++) {
+        write(0x2006, 0x3F);
+        write(0x2006, i);
+        write(0x2007, rnd(64));
+    }
+    write(0x2000, rng() & 0x7F);
+    write(0x2001, 0x18 | rng());
+
+    uint64_t steps = 0;
+    while (ref.frame_count < frames && diff.empty()) {
+        // Mostly short runs between accesses, now and then whole lines
+        int kind = rnd(100);
+        uint16_t dots = kind < 10   ? ntsc_x * (1 + rnd(40)) + rnd(ntsc_x)
+                        : kind < 40 ? 1 + rnd(ntsc_x * 3)
+                                    : 1 + rnd(40);
+        for (auto &ppu : ppus) ppu->execute(dots);
+        steps++;
+
+        int op = rnd(70);
+        if (op < 25) {
+            read(0x2002);
+        } else if (op < 30) {
+            uint8_t mask = rng();
+            write(0x2001, rnd(4) ? mask | 0x18 : mask);
+        } else if (op < 40) {
+            write(0x2005, rng());
+        } else if (op < 45) {
+            write(0x2000, rng() & 0x7F);
+        } else if (op < 50) {
+            write(0x2006, rnd(2) ? 0x20 + rnd(8) : rnd(0x40));
+        } else if (op < 55) {
+            write(0x2007, rng());
+        } else if (op < 60) {
+            read(0x2007);
+        } else if (op < 63) {
+            write(0x2003, rng());
+        } else if (op < 66) {
+            write(0x2004, rng());
+        } else if (op < 68) {
+            uint8_t page[0x100];
+            for (int i = 0; i < 0x100; i++)
+                page[i] = i % 4 || rnd(2) ? rng() : rnd(240);
+            for (auto &ppu : ppus) ppu->dma_oam(page);
+        } else {
+            write(0x2006, 0x3F);
+            write(0x2006, rnd(32));
+            write(0x2007, rnd(64));
+        }
+
+        for (int i = 1; i < 3 && diff.empty(); i++)
+            diff = ppu_diff(ref, *ppus[i], i == 1);
+    }
+
+    for (uint16_t addr = 0x0; addr < 0x2000 && diff.empty(); addr++) {
+        if (addr & 0x8) continue;
+        uint8_t pat_l = mapper->read_ppu(addr);
+        uint8_t pat_h = mapper->read_ppu(addr + 8);
+        uint16_t row = 0x0, flip = 0x0;
+        for (int i = 0; i < 8; i++) {
+            uint16_t color = ((pat_h >> i) & 1) << 1 | ((pat_l >> i) & 1);
+            row |= color << (i * 2);
+            flip |= color << ((7 - i) * 2);
+        }
+        if (ref.chr_row(addr) != row || ref.chr_row(addr, true) != flip)
+            diff = std::format("decoded tile row @{:04X}", addr);
+    }
+
+    std::cout << std::format(
+        "PPU fast paths, seed {}: {} frames, {} steps, {}\n", seed,
+        ref.frame_count, steps, diff.empty() ? "match" : "MISMATCH in " + diff);
+    return diff.empty();
+}
+
+/// Checks that every emphasis bit darkens the other two channels of every
+/// color and leaves its own, so all three bits darken the whole color.
+/// \return `true` if all colors are attenuated that way
+bool palette_emphasis(const Palette &pal) {
+    std::string diff;
+    for (uint8_t color = 0; color < Palette::colors && diff.empty(); color++) {
+        uint32_t plain = pal.get_rgba(color);
+        for (uint8_t emph = 1; emph < Palette::emphasis; emph++) {
+            uint32_t rgba = pal.get_rgba(color, emph << 5);
+            for (int ch = 0; ch < 3; ch++) {
+                uint8_t was = plain >> (24 - ch * 8);
+                uint8_t is = rgba >> (24 - ch * 8);
+                bool darker = is < was || (is == 0x0 && was == 0x0);
+                if (emph & ~(1 << ch) ? !darker : is != was)
+                    diff = std::format("color {:02X}, emphasis {}", color,
+                                       emph);
+            }
+        }
+    }
+    std::cout << std::format(
+        "Palette emphasis: {}\n",
+        diff.empty() ? "darkens the other channels" : "MISMATCH in " + diff);
+    return diff.empty();
+}
+
+/// Runs a ROM headless instruction by instruction, with the PPU synchronized
+/// after each one, then in batches with the bus catching the PPU up, and
+/// with the JIT. Checks that the CPU, RAM and PPU end up the same.
+/// \param frames Frames to run
+/// \return `true` if all runs matched
+bool ppu_sync(ExecutionEnvironment &ee, uint64_t frames) {
+    auto *bus = dynamic_cast<NES::MemoryBus *>(ee.bus);
+    std::string rom = sync_rom;
+    ee.load_iNESv1(rom);
+
+    std::unique_ptr<PPU> ref;
+    uint64_t ref_cycles = 0;
+    std::array<uint8_t, NES::MemoryBus::ram_size> ref_ram;
+    bool same = true;
+    for (int mode = 0; mode < 3; mode++) {
+        ee.run_single_step = mode == 0;
+        ee.enable_jit = mode == 2;
+        bus->ram.fill(0x0);
+        ee.power(nullptr);
+        ee.run_headless(frames);
+
+        if (!ref) {
+            ref = std::make_unique<PPU>(ee.ppu);
+            ref_cycles = ee.cpu.cycles;
+            ref_ram = bus->ram;
+            continue;
+        }
+        std::string diff = ppu_diff(*ref, ee.ppu, true);
+        if (ee.cpu.cycles != ref_cycles) diff = "CPU cycles";
+        if (bus->ram != ref_ram) diff = "RAM";
+        std::cout << std::format(
+            "PPU sync, {}: {}\n", mode == 1 ? "batched" : "batched with JIT",
+            diff.empty() ? "matches stepped" : "MISMATCH in " + diff);
+        same &= diff.empty();
+    }
+    ee.run_single_step = false;
+    ee.enable_jit = false;
+    return same;
+}
+
 } // namespace Test
 
 } // namespace NES